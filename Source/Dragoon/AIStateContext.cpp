@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "AIStateContext.h"
+#include "DragoonAIController.h"
+#include "PlayerFlowFields.h"
+
+void FAICommandBuffer::MoveToLocation( ADragoonAIController* controller, const FVector& location ) {
+	FAICommand command = { EAICommandType::AIC_MoveToLocation, controller, location, nullptr, 0, EAIStateType::AST_Guard };
+	commands.Add( command );
+}
+
+void FAICommandBuffer::MoveToTarget( ADragoonAIController* controller, const FVector& location ) {
+	FAICommand command = { EAICommandType::AIC_MoveToTarget, controller, location, nullptr, 0, EAIStateType::AST_Guard };
+	commands.Add( command );
+}
+
+void FAICommandBuffer::MoveAlongRoute( ADragoonAIController* controller, const UPatrolRoute* route, int32 leg, const FVector& location ) {
+	FAICommand command = { EAICommandType::AIC_MoveAlongRoute, controller, location, route, leg, EAIStateType::AST_Guard };
+	commands.Add( command );
+}
+
+void FAICommandBuffer::SteerToLocation( ADragoonAIController* controller, const FVector& location ) {
+	FAICommand command = { EAICommandType::AIC_SteerToLocation, controller, location, nullptr, 0, EAIStateType::AST_Guard };
+	commands.Add( command );
+}
+
+void FAICommandBuffer::SwapState( ADragoonAIController* controller, EAIStateType newState ) {
+	FAICommand command = { EAICommandType::AIC_SwapState, controller, FVector::ZeroVector, nullptr, 0, newState };
+	commands.Add( command );
+}
+
+void FAICommandBuffer::GetNewSlot( ADragoonAIController* controller ) {
+	FAICommand command = { EAICommandType::AIC_GetNewSlot, controller, FVector::ZeroVector, nullptr, 0, EAIStateType::AST_Guard };
+	commands.Add( command );
+}
+
+void FAICommandBuffer::AttackPlayer( ADragoonAIController* controller ) {
+	FAICommand command = { EAICommandType::AIC_AttackPlayer, controller, FVector::ZeroVector, nullptr, 0, EAIStateType::AST_Guard };
+	commands.Add( command );
+}
+
+void FAICommandBuffer::Apply() {
+	for ( FAICommand& command : commands ) {
+		ADragoonAIController* controller = command.controller;
+
+		// an earlier command may have killed the agent
+		if ( controller->GetAgent()->GetIsDead() )
+			continue;
+
+		switch ( command.type ) {
+		case EAICommandType::AIC_MoveToLocation:
+			controller->MoveToLocation( command.location );
+			break;
+		case EAICommandType::AIC_MoveToTarget:
+			controller->targetLoc = command.location;
+			controller->MoveToLocation( command.location );
+			break;
+		case EAICommandType::AIC_MoveAlongRoute:
+			controller->MoveAlongRoute( command.route, command.leg, command.location );
+			break;
+		case EAICommandType::AIC_SteerToLocation:
+			// the flow field has already found the way, so the agent walks straight there
+			controller->MoveToLocation( command.location, -1, true, false );
+			break;
+		case EAICommandType::AIC_SwapState:
+			controller->SwapState( command.newState );
+			break;
+		case EAICommandType::AIC_GetNewSlot:
+			controller->GetAttackCircle()->GetNewSlotForAgent( controller->GetAgent() );
+			break;
+		case EAICommandType::AIC_AttackPlayer:
+			controller->AttackPlayer();
+			break;
+		}
+	}
+	commands.Reset();
+}
+
+bool FAIStateContext::MoveNearPlayer( const FVector& destination ) {
+	// steer while far away, where every agent closing in on the player would otherwise find much the same long path
+	const FFlowField* field = snapshot.flowField;
+	FVector steeringTarget;
+	if ( field && FVector::DistSquared2D( snapshot.location, destination ) > FMath::Square( field->handoffDistance )
+		&& field->GetSteeringTarget( snapshot.location, steeringTarget ) ) {
+		commands.SteerToLocation( snapshot.controller, steeringTarget );
+		return true;
+	}
+
+	commands.MoveToLocation( snapshot.controller, destination );
+	return false;
+}
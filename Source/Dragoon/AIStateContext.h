@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "State.h"
+
+class ADragoonAIController;
+class UPatrolRoute;
+struct FFlowField;
+
+/**
+ * Everything a state reads about its agent and the world while deciding what to do. Taken on the game thread
+ * before states tick, so states can tick on worker threads without touching actors.
+ */
+struct FAIAgentSnapshot {
+	// the controller commands are recorded for. Only used to address commands, never read from while deciding
+	ADragoonAIController* controller = nullptr;
+
+	// seconds since the agent's state last ticked
+	float deltaSeconds = 0;
+
+	// where the agent is
+	FVector location = FVector::ZeroVector;
+
+	// where the agent was last sent while guarding
+	FVector targetLocation = FVector::ZeroVector;
+
+	// the agent's post and patrol route. Set up in the editor and never changed during play
+	FVector guardPost = FVector::ZeroVector;
+	const TArray<FVector>* waypoints = nullptr;
+	const UPatrolRoute* patrolRoute = nullptr;
+	bool bIsPatrolContinuous = true;
+
+	// true if the agent is attacking, parrying, dodging or otherwise can't act
+	bool bIsBusy = false;
+
+	// where the player the agent is fighting is. Only set for agents in combat
+	bool bHasPlayer = false;
+	FVector playerLocation = FVector::ZeroVector;
+
+	// the flow field leading to the player. Only set for agents in combat once the player's field has been built
+	const FFlowField* flowField = nullptr;
+
+	// the agent's attack circle slot, its version and where it is. Only set for agents in AttackState
+	int32 circleSlot = -1;
+	uint32 slotVersion = 0;
+	FVector slotLocation = FVector::ZeroVector;
+	bool bIsSlotNavigable = false;
+};
+
+// enum for the kinds of command states can record for the game thread
+enum class EAICommandType : uint8 {
+	AIC_MoveToLocation,
+	AIC_MoveToTarget,
+	AIC_MoveAlongRoute,
+	AIC_SteerToLocation,
+	AIC_SwapState,
+	AIC_GetNewSlot,
+	AIC_AttackPlayer
+};
+
+/**
+ * Something a state wants done to the world, recorded while deciding and carried out later on the game thread
+ */
+struct FAICommand {
+	// what to do
+	EAICommandType type;
+
+	// the controller to do it with
+	ADragoonAIController* controller;
+
+	// where to move to
+	FVector location;
+
+	// the route and leg to follow the cached path of
+	const UPatrolRoute* route;
+	int32 leg;
+
+	// the kind of state to change to
+	EAIStateType newState;
+};
+
+/**
+ * Commands recorded by the states ticked on one worker. Buffers are applied one after another in a fixed order,
+ * so the result doesn't depend on which worker finished first.
+ */
+class DRAGOON_API FAICommandBuffer
+{
+private:
+	TArray<FAICommand> commands;
+
+public:
+	/**
+	 * Records moving an agent to a location
+	 */
+	void MoveToLocation( ADragoonAIController* controller, const FVector& location );
+
+	/**
+	 * Records moving an agent to a location that becomes the controller's targetLoc
+	 */
+	void MoveToTarget( ADragoonAIController* controller, const FVector& location );
+
+	/**
+	 * Records moving an agent along a leg of a patrol route, following the path cached for that leg
+	 * @param leg	index of the waypoint the leg starts at. The agent moves to the next waypoint
+	 */
+	void MoveAlongRoute( ADragoonAIController* controller, const UPatrolRoute* route, int32 leg, const FVector& location );
+
+	/**
+	 * Records moving an agent straight to a location without finding a path. Only for locations the agent is known to be able to walk straight to
+	 */
+	void SteerToLocation( ADragoonAIController* controller, const FVector& location );
+
+	/**
+	 * Records changing an agent's state
+	 */
+	void SwapState( ADragoonAIController* controller, EAIStateType newState );
+
+	/**
+	 * Records asking the agent's attack circle for a new slot
+	 */
+	void GetNewSlot( ADragoonAIController* controller );
+
+	/**
+	 * Records having the agent pick an attack and ask its attack circle to make it
+	 */
+	void AttackPlayer( ADragoonAIController* controller );
+
+	/**
+	 * Carries out every recorded command in the order it was recorded and empties the buffer. Game thread only
+	 */
+	void Apply();
+};
+
+/**
+ * What a state is given when it ticks: the snapshot to read, the buffer to record commands into and the agent's own random numbers
+ */
+struct FAIStateContext {
+	const FAIAgentSnapshot& snapshot;
+	FAICommandBuffer& commands;
+	FRandomStream& random;
+
+	/**
+	 * Records moving the agent toward a destination near the player. While the agent is far from the destination it steers along
+	 * the player's flow field instead of finding a path, and it finds a path for the last stretch.
+	 * @param destination	where the agent is going
+	 * @returns	true if the agent was steered, in which case it should be moved toward the destination again shortly
+	 */
+	bool MoveNearPlayer( const FVector& destination );
+};
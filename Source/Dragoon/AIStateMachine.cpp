@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "AIStateMachine.h"
+
+void FAIStateMachine::Reset( EAIStateType newType ) {
+	type = newType;
+	switch ( type ) {
+	case EAIStateType::AST_Guard:
+		guard = GuardState();
+		break;
+	case EAIStateType::AST_Patrol:
+		patrol = PatrolState();
+		break;
+	case EAIStateType::AST_Alert:
+		alert = AlertState();
+		break;
+	case EAIStateType::AST_Attack:
+		attack = AttackState();
+		break;
+	}
+}
+
+void FAIStateMachine::EnterState( AEnemyAgent* agent ) {
+	switch ( type ) {
+	case EAIStateType::AST_Guard:
+		guard.EnterState( agent );
+		break;
+	case EAIStateType::AST_Patrol:
+		patrol.EnterState( agent );
+		break;
+	case EAIStateType::AST_Alert:
+		alert.EnterState( agent );
+		break;
+	case EAIStateType::AST_Attack:
+		attack.EnterState( agent );
+		break;
+	}
+}
+
+void FAIStateMachine::StateTick( FAIStateContext& context ) {
+	switch ( type ) {
+	case EAIStateType::AST_Guard:
+		guard.StateTick( context );
+		break;
+	case EAIStateType::AST_Patrol:
+		patrol.StateTick( context );
+		break;
+	case EAIStateType::AST_Alert:
+		alert.StateTick( context );
+		break;
+	case EAIStateType::AST_Attack:
+		attack.StateTick( context );
+		break;
+	}
+}
+
+void FAIStateMachine::ExitState( AEnemyAgent* agent ) {
+	switch ( type ) {
+	case EAIStateType::AST_Guard:
+		guard.ExitState( agent );
+		break;
+	case EAIStateType::AST_Patrol:
+		patrol.ExitState( agent );
+		break;
+	case EAIStateType::AST_Alert:
+		alert.ExitState( agent );
+		break;
+	case EAIStateType::AST_Attack:
+		attack.ExitState( agent );
+		break;
+	}
+}
@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "GuardState.h"
+#include "PatrolState.h"
+#include "AlertState.h"
+#include "AttackState.h"
+
+/**
+ * Holds every state an agent can be in, kept inside the agent's controller so changing state never allocates.
+ * Only the state named by type is in use. Calls are passed on with a switch on type rather than through virtual functions,
+ * and the state tick manager ticks agents one kind of state after another, so the same case is taken agent after agent.
+ */
+struct DRAGOON_API FAIStateMachine {
+	// the state in use
+	EAIStateType type = EAIStateType::AST_Guard;
+
+	// one of each state. Every state is only a few numbers, so they sit side by side rather than sharing storage
+	GuardState guard;
+	PatrolState patrol;
+	AlertState alert;
+	AttackState attack;
+
+	/**
+	 * Resets the state of the given kind to a fresh one and makes it the state in use. Does not enter it
+	 * @param newType	the kind of state to use
+	 */
+	void Reset( EAIStateType newType );
+
+	/**
+	 * Enters the state in use
+	 * @param agent	The agent who is using this state for behavior.
+	 */
+	void EnterState( AEnemyAgent* agent );
+
+	/**
+	 * Ticks the state in use. May run on a worker thread alongside other states, so states must only read the context's snapshot
+	 * and record what they want done in the context's commands
+	 * @param context	The snapshot of the agent to read, and the commands to record into.
+	 */
+	void StateTick( FAIStateContext& context );
+
+	/**
+	 * Exits the state in use
+	 * @param agent	The agent who is using this state for behavior.
+	 */
+	void ExitState( AEnemyAgent* agent );
+};
@@ -0,0 +1,233 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "AIStateTickManager.h"
+#include "DragoonAIController.h"
+#include "AttackCircleManager.h"
+#include "PlayerFlowFields.h"
+#include "Async/ParallelFor.h"
+
+// compare frame time against the number of agents
+DECLARE_CYCLE_STAT( TEXT( "State Snapshots" ), STAT_DragoonStateSnapshots, STATGROUP_DragoonAI );
+DECLARE_CYCLE_STAT( TEXT( "State Tick" ), STAT_DragoonStateTick, STATGROUP_DragoonAI );
+DECLARE_CYCLE_STAT( TEXT( "State Changes" ), STAT_DragoonStateChanges, STATGROUP_DragoonAI );
+DECLARE_DWORD_COUNTER_STAT( TEXT( "Ticked Agents" ), STAT_DragoonTickedAgents, STATGROUP_DragoonAI );
+DECLARE_DWORD_COUNTER_STAT( TEXT( "Skipped Agents" ), STAT_DragoonSkippedAgents, STATGROUP_DragoonAI );
+
+AIStateTickManager::AIStateTickManager()
+{
+}
+
+AIStateTickManager::~AIStateTickManager()
+{
+}
+
+void AIStateTickManager::AddController( ADragoonAIController* controller ) {
+	if ( controller->GetStateBatchIndex() < 0 )
+		AddToBatch( controller, 0 );
+}
+
+void AIStateTickManager::RemoveController( ADragoonAIController* controller ) {
+	if ( controller->GetStateBatchIndex() < 0 )
+		return;
+
+	// batches are being walked, so wait until they are done
+	if ( bIsTicking ) {
+		pendingRemovals.AddUnique( controller );
+		return;
+	}
+
+	RemoveFromBatch( controller );
+	pendingStateChanges.RemoveSingleSwap( controller );
+}
+
+void AIStateTickManager::QueueStateChange( ADragoonAIController* controller ) {
+	pendingStateChanges.AddUnique( controller );
+}
+
+void AIStateTickManager::Tick( float deltaSeconds ) {
+	int32 numTicked = 0;
+	int32 numSkipped = 0;
+	{
+		SCOPE_CYCLE_COUNTER( STAT_DragoonStateSnapshots );
+		bIsTicking = true;
+
+		// every agent's rate is measured against where the players are this frame
+		playerLocations.Reset();
+		if ( attackCircles ) {
+			for ( int32 i = 0; i < attackCircles->GetNumCircles(); i++ ) {
+				ADragoonCharacter* player = attackCircles->GetCircle( i )->GetPlayer();
+				if ( player )
+					playerLocations.Add( player->GetActorLocation() );
+			}
+		}
+
+		// snapshot every agent whose interval has passed, one kind of state after another
+		tickSnapshots.Reset();
+		tickStates.Reset();
+		for ( int32 type = 0; type < ( int32 )EAIStateType::AST_Count; type++ ) {
+			FStateBatch& batch = batches[ type ];
+			for ( int32 i = 0; i < batch.controllers.Num(); i++ ) {
+				if ( batch.agents[ i ]->GetIsDead() )
+					continue;
+
+				// wait until the agent's interval has passed, then give the state all the time that has gone by
+				float elapsedSeconds = batch.accumulatedSeconds[ i ] + deltaSeconds;
+				if ( elapsedSeconds < batch.tickIntervals[ i ] ) {
+					batch.accumulatedSeconds[ i ] = elapsedSeconds;
+					numSkipped++;
+					continue;
+				}
+				batch.accumulatedSeconds[ i ] = 0;
+				batch.controllers[ i ]->UpdateControlRotation( elapsedSeconds );
+				batch.tickIntervals[ i ] = GetTickInterval( batch.agents[ i ], ( EAIStateType )type );
+
+				FAIAgentSnapshot& snapshot = tickSnapshots[ tickSnapshots.AddDefaulted() ];
+				snapshot.deltaSeconds = elapsedSeconds;
+				TakeSnapshot( batch.controllers[ i ], ( EAIStateType )type, snapshot );
+				tickStates.Add( batch.states[ i ] );
+			}
+		}
+		numTicked = tickSnapshots.Num();
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER( STAT_DragoonStateTick );
+
+		// each group of agents records into its own buffer, so workers never share one
+		int32 groupSize = FMath::Max( agentsPerCommandBuffer, 1 );
+		int32 numGroups = ( numTicked + groupSize - 1 ) / groupSize;
+		if ( commandBuffers.Num() < numGroups )
+			commandBuffers.SetNum( numGroups );
+
+		// states only read their snapshot and write to their own members and buffer, so groups can decide at the same time
+		ParallelFor( numGroups, [ this, groupSize, numTicked ]( int32 group ) {
+			FAICommandBuffer& commands = commandBuffers[ group ];
+			int32 end = FMath::Min( ( group + 1 ) * groupSize, numTicked );
+			for ( int32 i = group * groupSize; i < end; i++ ) {
+				FAIStateContext context = { tickSnapshots[ i ], commands, tickSnapshots[ i ].controller->GetRandomStream() };
+				tickStates[ i ]->StateTick( context );
+			}
+		}, !bTickStatesInParallel );
+
+		// carry out what was decided in the same order every time
+		for ( int32 group = 0; group < numGroups; group++ )
+			commandBuffers[ group ].Apply();
+
+		bIsTicking = false;
+	}
+
+	SCOPE_CYCLE_COUNTER( STAT_DragoonStateChanges );
+
+	// take out controllers that were removed while ticking
+	for ( ADragoonAIController* controller : pendingRemovals )
+		RemoveController( controller );
+	pendingRemovals.Reset();
+
+	// move every controller that changed state to the batch for its new state
+	for ( int32 i = 0; i < pendingStateChanges.Num(); i++ ) {
+		ADragoonAIController* controller = pendingStateChanges[ i ];
+		float accumulatedSeconds = RemoveFromBatch( controller );
+		controller->TransitionBetweenStates();
+		AddToBatch( controller, accumulatedSeconds );
+	}
+	pendingStateChanges.Reset();
+
+	SET_DWORD_STAT( STAT_DragoonTickedAgents, numTicked );
+	SET_DWORD_STAT( STAT_DragoonSkippedAgents, numSkipped );
+}
+
+int32 AIStateTickManager::GetNumControllers() const {
+	int32 numControllers = 0;
+	for ( const FStateBatch& batch : batches )
+		numControllers += batch.controllers.Num();
+	return numControllers;
+}
+
+void AIStateTickManager::AddToBatch( ADragoonAIController* controller, float accumulatedSeconds ) {
+	FAIStateMachine& stateMachine = controller->GetStateMachine();
+
+	// a new state ticks on the next frame, so it starts from up to date information
+	FStateBatch& batch = batches[ ( int32 )stateMachine.type ];
+	controller->SetStateBatchIndex( batch.controllers.Num() );
+	batch.controllers.Add( controller );
+	batch.agents.Add( controller->GetAgent() );
+	batch.states.Add( &stateMachine );
+	batch.accumulatedSeconds.Add( accumulatedSeconds );
+	batch.tickIntervals.Add( 0 );
+}
+
+float AIStateTickManager::RemoveFromBatch( ADragoonAIController* controller ) {
+	int32 index = controller->GetStateBatchIndex();
+	if ( index < 0 )
+		return 0;
+
+	// the batch is found from the state the controller was added with, so this must happen before the state changes
+	FStateBatch& batch = batches[ ( int32 )controller->GetCurrentStateType() ];
+	float accumulatedSeconds = batch.accumulatedSeconds[ index ];
+	batch.controllers.RemoveAtSwap( index, 1, false );
+	batch.agents.RemoveAtSwap( index, 1, false );
+	batch.states.RemoveAtSwap( index, 1, false );
+	batch.accumulatedSeconds.RemoveAtSwap( index, 1, false );
+	batch.tickIntervals.RemoveAtSwap( index, 1, false );
+	if ( index < batch.controllers.Num() )
+		batch.controllers[ index ]->SetStateBatchIndex( index );
+	controller->SetStateBatchIndex( -1 );
+	return accumulatedSeconds;
+}
+
+float AIStateTickManager::GetTickInterval( const AEnemyAgent* agent, EAIStateType stateType ) const {
+	// agents fighting a player always tick every frame
+	if ( stateType == EAIStateType::AST_Alert || stateType == EAIStateType::AST_Attack )
+		return 0;
+
+	// with no players there is nothing to be near
+	if ( playerLocations.Num() == 0 )
+		return lodFarInterval;
+
+	FVector agentLocation = agent->GetActorLocation();
+	float nearestDistanceSquared = MAX_FLT;
+	for ( const FVector& playerLocation : playerLocations )
+		nearestDistanceSquared = FMath::Min( nearestDistanceSquared, FVector::DistSquared( agentLocation, playerLocation ) );
+
+	if ( nearestDistanceSquared < FMath::Square( lodNearDistance ) )
+		return 0;
+
+	// agents on screen move often enough to look natural even when far away
+	bool bIsOnScreen = agent->GetWorld()->TimeSince( agent->GetLastRenderTime() ) < 0.2f;
+	if ( bIsOnScreen || nearestDistanceSquared < FMath::Square( lodFarDistance ) )
+		return lodMidInterval;
+
+	return lodFarInterval;
+}
+
+void AIStateTickManager::TakeSnapshot( ADragoonAIController* controller, EAIStateType stateType, FAIAgentSnapshot& snapshot ) {
+	AEnemyAgent* agent = controller->GetAgent();
+	snapshot.controller = controller;
+	snapshot.location = agent->GetActorLocation();
+	snapshot.targetLocation = controller->targetLoc;
+	snapshot.guardPost = agent->guardPost;
+	snapshot.waypoints = &agent->GetPatrolWaypoints();
+	snapshot.patrolRoute = agent->patrolRoute;
+	snapshot.bIsPatrolContinuous = agent->bIsPatrolContinuous;
+	snapshot.bIsBusy = agent->IsBusy();
+
+	// only agents in combat have a circle to read from
+	if ( stateType != EAIStateType::AST_Alert && stateType != EAIStateType::AST_Attack )
+		return;
+
+	AttackCircle* attackCircle = controller->GetAttackCircle();
+	if ( !attackCircle || !attackCircle->GetPlayer() )
+		return;
+
+	snapshot.bHasPlayer = true;
+	snapshot.playerLocation = attackCircle->GetPlayer()->GetActorLocation();
+	if ( flowFields )
+		snapshot.flowField = flowFields->GetField( agent->GetAttackCircleIndex() );
+	if ( stateType == EAIStateType::AST_Attack ) {
+		snapshot.circleSlot = agent->GetCircleSlot();
+		snapshot.slotVersion = attackCircle->GetSlotVersion( snapshot.circleSlot );
+		snapshot.slotLocation = attackCircle->GetLocationForAgent( agent );
+		snapshot.bIsSlotNavigable = attackCircle->IsSlotNavigable( snapshot.circleSlot );
+	}
+}
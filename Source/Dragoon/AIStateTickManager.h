@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "AIStateMachine.h"
+
+class ADragoonAIController;
+class AttackCircleManager;
+class PlayerFlowFields;
+
+/**
+ * Ticks the state of every AI controller from one engine tick, instead of each controller ticking itself.
+ * Controllers are kept in one batch per kind of state, with their agents and states packed alongside them, so every
+ * agent in the same kind of state is ticked back to back. State changes are applied after every batch has ticked,
+ * which is when controllers move between batches.
+ * States decide what to do on worker threads, reading a snapshot of their agent taken on the game thread and recording
+ * what they want done into one command buffer per group of agents. The game thread then applies the buffers in order.
+ * Agents out of combat and away from every player are ticked less often. The time between their ticks is added up
+ * and passed to the state as one tick, so states behave the same at any rate.
+ */
+class DRAGOON_API AIStateTickManager
+{
+public:
+	// Agents out of combat closer than this in cm to a player are ticked every frame
+	float lodNearDistance = 1500;
+
+	// Agents out of combat closer than this in cm to a player, or on screen, are ticked every lodMidInterval seconds
+	float lodFarDistance = 5000;
+
+	// Seconds between ticks of agents out of combat at middle distance or on screen
+	float lodMidInterval = 0.1f;
+
+	// Seconds between ticks of agents out of combat that are far away and off screen
+	float lodFarInterval = 0.5f;
+
+	// Tick states on worker threads. Turn off to tick every state on the game thread when debugging
+	bool bTickStatesInParallel = true;
+
+	// Number of agents each worker decides for at a time. Each group records into its own command buffer
+	int32 agentsPerCommandBuffer = 32;
+
+private:
+	// Controllers in the same kind of state, with their agents and states at the same index
+	struct FStateBatch {
+		TArray<ADragoonAIController*> controllers;
+		TArray<AEnemyAgent*> agents;
+		TArray<FAIStateMachine*> states;
+
+		// seconds since each agent's state last ticked, and how many seconds to wait between its ticks
+		TArray<float> accumulatedSeconds;
+		TArray<float> tickIntervals;
+	};
+
+	// one batch for each kind of state
+	FStateBatch batches[ ( int32 )EAIStateType::AST_Count ];
+
+	// controllers waiting to change state once every batch has ticked
+	TArray<ADragoonAIController*> pendingStateChanges;
+
+	// controllers removed while the batches were ticking. Taken out of their batch once ticking is done
+	TArray<ADragoonAIController*> pendingRemovals;
+
+	// true while the batches are ticking. Batches must not change then
+	bool bIsTicking = false;
+
+	// circles of the players agents are ticked faster near
+	AttackCircleManager* attackCircles = nullptr;
+
+	// flow fields agents in combat steer along
+	const PlayerFlowFields* flowFields = nullptr;
+
+	// locations of every player this frame
+	TArray<FVector> playerLocations;
+
+	// snapshots and states of the agents ticking this frame, batch by batch
+	TArray<FAIAgentSnapshot> tickSnapshots;
+	TArray<FAIStateMachine*> tickStates;
+
+	// one buffer for each group of agentsPerCommandBuffer agents ticking this frame
+	TArray<FAICommandBuffer> commandBuffers;
+
+public:
+	AIStateTickManager();
+	~AIStateTickManager();
+
+	/**
+	 * Sets the attack circle manager the players' locations are read from
+	 * @param circles	the manager of the attack circles, one per player
+	 */
+	FORCEINLINE void SetAttackCircles( AttackCircleManager* circles ) { attackCircles = circles; }
+
+	/**
+	 * Sets the flow fields agents in combat steer along
+	 * @param fields	the flow fields, one per player
+	 */
+	FORCEINLINE void SetFlowFields( const PlayerFlowFields* fields ) { flowFields = fields; }
+
+	/**
+	 * Starts ticking a controller. The controller must have entered its first state
+	 * @param controller	the controller to tick
+	 */
+	void AddController( ADragoonAIController* controller );
+
+	/**
+	 * Stops ticking a controller. Does nothing if the controller is not being ticked
+	 * @param controller	the controller that is dying or leaving the game
+	 */
+	void RemoveController( ADragoonAIController* controller );
+
+	/**
+	 * Has a controller change to its next state once every batch has ticked
+	 * @param controller	the controller with a state change ready
+	 */
+	void QueueStateChange( ADragoonAIController* controller );
+
+	/**
+	 * Ticks the state of every controller, batch by batch, then applies state changes
+	 * @param deltaSeconds	time since the last tick
+	 */
+	void Tick( float deltaSeconds );
+
+	/** Returns the number of controllers being ticked **/
+	int32 GetNumControllers() const;
+
+private:
+	/**
+	 * Puts a controller at the end of the batch for its current state
+	 * @param accumulatedSeconds	seconds since the controller's state last ticked
+	 */
+	void AddToBatch( ADragoonAIController* controller, float accumulatedSeconds );
+
+	/**
+	 * Takes a controller out of its batch, moving the last controller of the batch into its place
+	 * @returns	seconds since the controller's state last ticked
+	 */
+	float RemoveFromBatch( ADragoonAIController* controller );
+
+	/**
+	 * Returns how many seconds to wait between ticks of an agent, from its kind of state, distance to the nearest player and whether it is on screen
+	 * @param agent		the agent to choose a rate for
+	 * @param stateType	the kind of state the agent is in
+	 */
+	float GetTickInterval( const AEnemyAgent* agent, EAIStateType stateType ) const;
+
+	/**
+	 * Fills in a snapshot of everything the controller's state reads while deciding
+	 * @param controller	the controller whose agent is ticking
+	 * @param stateType		the kind of state the agent is in
+	 * @param snapshot		the snapshot to fill in
+	 */
+	void TakeSnapshot( ADragoonAIController* controller, EAIStateType stateType, FAIAgentSnapshot& snapshot );
+};
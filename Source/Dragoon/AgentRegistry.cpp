@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "AgentRegistry.h"
+
+FAgentHandle AgentRegistry::Add( AEnemyAgent* agent ) {
+	// reuse a free slot if there is one
+	int32 slotIndex;
+	if ( freeSlots.Num() > 0 )
+		slotIndex = freeSlots.Pop( false );
+	else
+		slotIndex = slots.AddDefaulted();
+
+	// new agents start out of combat, which is the end of the dense arrays
+	FSlot& slot = slots[ slotIndex ];
+	slot.denseIndex = denseAgents.Add( agent );
+	denseSlots.Add( slotIndex );
+
+	FAgentHandle handle;
+	handle.index = slotIndex;
+	handle.generation = slot.generation;
+	return handle;
+}
+
+bool AgentRegistry::Remove( FAgentHandle handle ) {
+	if ( !IsValid( handle ) )
+		return false;
+
+	// an agent in combat first moves to the end of the combat group so removing it keeps the groups contiguous
+	int32 denseIndex = slots[ handle.index ].denseIndex;
+	if ( denseIndex < numInCombat ) {
+		SwapDense( denseIndex, numInCombat - 1 );
+		denseIndex = --numInCombat;
+	}
+
+	// fill the gap with the last agent, which is never in combat unless every agent is
+	int32 last = denseAgents.Num() - 1;
+	SwapDense( denseIndex, last );
+	denseAgents.Pop( false );
+	denseSlots.Pop( false );
+
+	// free the slot and make every handle to it invalid
+	FSlot& slot = slots[ handle.index ];
+	slot.denseIndex = -1;
+	slot.generation++;
+	freeSlots.Add( handle.index );
+	return true;
+}
+
+bool AgentRegistry::SetInCombat( FAgentHandle handle, bool bInCombat ) {
+	if ( !IsValid( handle ) || IsInCombat( handle ) == bInCombat )
+		return false;
+
+	// moving across the boundary between the groups only needs one swap
+	int32 denseIndex = slots[ handle.index ].denseIndex;
+	if ( bInCombat ) {
+		SwapDense( denseIndex, numInCombat );
+		numInCombat++;
+	}
+	else {
+		numInCombat--;
+		SwapDense( denseIndex, numInCombat );
+	}
+	return true;
+}
+
+void AgentRegistry::Reset() {
+	// free every slot in use
+	for ( int32 slotIndex : denseSlots ) {
+		slots[ slotIndex ].denseIndex = -1;
+		slots[ slotIndex ].generation++;
+		freeSlots.Add( slotIndex );
+	}
+	denseAgents.Reset();
+	denseSlots.Reset();
+	numInCombat = 0;
+}
+
+void AgentRegistry::SwapDense( int32 first, int32 second ) {
+	if ( first == second )
+		return;
+
+	denseAgents.Swap( first, second );
+	denseSlots.Swap( first, second );
+	slots[ denseSlots[ first ] ].denseIndex = first;
+	slots[ denseSlots[ second ] ].denseIndex = second;
+}
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class AEnemyAgent;
+
+/**
+ * Identifies an agent registered with an AgentRegistry. The generation makes handles to removed agents invalid,
+ * even once their slot has been given to another agent.
+ */
+struct FAgentHandle {
+	// slot of the agent in the registry. -1 if the handle is not set
+	int32 index = -1;
+
+	// generation of the slot when the agent was registered
+	uint32 generation = 0;
+
+	/** Returns true if the handle has been set. The agent may still have been removed since **/
+	FORCEINLINE bool IsSet() const { return index >= 0; }
+
+	FORCEINLINE bool operator==( const FAgentHandle& other ) const { return index == other.index && generation == other.generation; }
+	FORCEINLINE bool operator!=( const FAgentHandle& other ) const { return !( *this == other ); }
+};
+
+/**
+ * Sparse set of registered agents, split into agents in combat and agents not in combat.
+ * Handles index a sparse array of slots, and each slot points into a dense array of agents. Agents in combat are kept at the
+ * front of the dense array and the rest after them, so registering, removing, membership tests and moving an agent in or out
+ * of combat are all constant time, and both groups can be iterated without gaps.
+ */
+class DRAGOON_API AgentRegistry
+{
+private:
+	/**
+	 * Entry of the sparse array
+	 */
+	struct FSlot {
+		// incremented every time the slot is freed, so old handles to it stop being valid
+		uint32 generation = 0;
+
+		// index of the agent in the dense arrays. -1 if the slot is free
+		int32 denseIndex = -1;
+	};
+
+	// one entry per handle index ever given out
+	TArray<FSlot> slots;
+
+	// slots that are free to be given to the next registered agent
+	TArray<int32> freeSlots;
+
+	// every registered agent. The first numInCombat are in combat
+	TArray<AEnemyAgent*> denseAgents;
+
+	// slot of each agent in denseAgents
+	TArray<int32> denseSlots;
+
+	// number of agents at the front of denseAgents that are in combat
+	int32 numInCombat = 0;
+
+public:
+	/**
+	 * Adds an agent to the registry as not in combat.
+	 * @param agent	the agent to add
+	 * @returns	the handle that identifies the agent in the registry
+	 */
+	FAgentHandle Add( AEnemyAgent* agent );
+
+	/**
+	 * Removes an agent from the registry. Its handle and any copies of it stop being valid.
+	 * @param handle	the agent's handle
+	 * @returns	false if the handle was not valid
+	 */
+	bool Remove( FAgentHandle handle );
+
+	/**
+	 * Moves an agent in or out of combat.
+	 * @param handle		the agent's handle
+	 * @param bInCombat		true to move the agent into combat
+	 * @returns	false if the handle was not valid or the agent was already in that group
+	 */
+	bool SetInCombat( FAgentHandle handle, bool bInCombat );
+
+	/**
+	 * Removes every agent. Every handle given out stops being valid.
+	 */
+	void Reset();
+
+	/** Returns true if handle refers to a registered agent **/
+	FORCEINLINE bool IsValid( FAgentHandle handle ) const {
+		return handle.index >= 0 && handle.index < slots.Num() && slots[ handle.index ].generation == handle.generation && slots[ handle.index ].denseIndex >= 0;
+	}
+
+	/** Returns the agent handle refers to, or nullptr if the handle is not valid **/
+	FORCEINLINE AEnemyAgent* Get( FAgentHandle handle ) const { return IsValid( handle ) ? denseAgents[ slots[ handle.index ].denseIndex ] : nullptr; }
+
+	/** Returns true if handle refers to a registered agent that is in combat **/
+	FORCEINLINE bool IsInCombat( FAgentHandle handle ) const { return IsValid( handle ) && slots[ handle.index ].denseIndex < numInCombat; }
+
+	/** Returns the number of registered agents **/
+	FORCEINLINE int32 Num() const { return denseAgents.Num(); }
+	/** Returns numInCombat **/
+	FORCEINLINE int32 GetNumInCombat() const { return numInCombat; }
+	/** Returns the number of registered agents not in combat **/
+	FORCEINLINE int32 GetNumNotInCombat() const { return denseAgents.Num() - numInCombat; }
+	/** Returns the index-th agent in combat **/
+	FORCEINLINE AEnemyAgent* GetAgentInCombat( int32 index ) const { return denseAgents[ index ]; }
+	/** Returns the index-th agent not in combat **/
+	FORCEINLINE AEnemyAgent* GetAgentNotInCombat( int32 index ) const { return denseAgents[ numInCombat + index ]; }
+
+private:
+	/**
+	 * Swaps two entries of the dense arrays and points their slots at their new positions
+	 */
+	void SwapDense( int32 first, int32 second );
+};
@@ -3,7 +3,6 @@
 #include "Dragoon.h"
 #include "DragoonAIController.h"
 #include "DragoonGameMode.h"
-#include "AttackState.h"
 #include "AlertState.h"
 
 AlertState::AlertState()
@@ -15,8 +14,9 @@ AlertState::~AlertState()
 }
 
 void AlertState::EnterState( AEnemyAgent* agent ) {
-	// have agent look at player
+	// fight whichever player is nearest, then have agent look at them
 	ADragoonAIController* controller = ( ADragoonAIController* )agent->GetController();
+	controller->GetGameMode()->attackCircles.RouteAgent( agent );
 	controller->SetFocus( controller->GetAttackCircle()->GetPlayer() );
 
 	// have agent join the blackboard list for agents ready for combat
@@ -24,16 +24,31 @@ void AlertState::EnterState( AEnemyAgent* agent ) {
 
 	// initialize position
 	position = agent->GetActorLocation();
+
+	// get in line once. The circle tells the controller when there is room
+	controller->GetAttackCircle()->EnqueueForAdmission( agent );
 }
 
-void AlertState::StateTick( AEnemyAgent* agent, float DeltaSeconds ) {
-	if ( agent->IsBusy() )
+void AlertState::StateTick( FAIStateContext& context ) {
+	const FAIAgentSnapshot& snapshot = context.snapshot;
+	if ( snapshot.bIsBusy || !snapshot.bHasPlayer )
+		return;
+
+	// the player moves a little each frame, so the standoff position only needs checking now and then
+	timeUntilStandoffCheck -= snapshot.deltaSeconds;
+	if ( timeUntilStandoffCheck > 0 )
 		return;
+	timeUntilStandoffCheck = standoffCheckInterval;
+
+	// keep steering until close enough to find a path the rest of the way
+	if ( bIsSteering ) {
+		bIsSteering = context.MoveNearPlayer( position );
+		return;
+	}
 
 	// stay near player, but keep distance further out than attack circle
-	ADragoonAIController* controller = ( ADragoonAIController* )agent->GetController();
 	// subtract agent from player to get the vector for agent going away from the player. (player - agent = vector towards player from agent)
-	FVector vectorAwayFromPlayer = position - controller->GetAttackCircle()->GetPlayer()->GetActorLocation();
+	FVector vectorAwayFromPlayer = position - snapshot.playerLocation;
 
 	// get current distance from player and normalize the vector
 	float currentDistanceAway = vectorAwayFromPlayer.Size();
@@ -42,17 +57,16 @@ void AlertState::StateTick( AEnemyAgent* agent, float DeltaSeconds ) {
 	// move to a new position if agent isn't inside the buffer zone
 	if ( currentDistanceAway < minDistanceFromPlayer || currentDistanceAway > maxDistanceFromPlayer ) {
 		// figure out a point away from the agent to get the preferred distance away from the player
-		position = agent->GetActorLocation() + ( vectorAwayFromPlayer * ( FMath::FRandRange( minDistanceFromPlayer, maxDistanceFromPlayer ) - currentDistanceAway ) );
-		controller->MoveToLocation( position );
+		position = snapshot.location + ( vectorAwayFromPlayer * ( context.random.FRandRange( minDistanceFromPlayer, maxDistanceFromPlayer ) - currentDistanceAway ) );
+		bIsSteering = context.MoveNearPlayer( position );
 	}
-
-	// check if we can join attack circle to attack player
-	if ( controller->GetAttackCircle()->CanAgentJoinCircle( agent ) )
-		controller->SwapState( ( State* )new AttackState() );
 }
 
 void AlertState::ExitState( AEnemyAgent* agent ) {
 	// clear focus
 	ADragoonAIController* controller = ( ADragoonAIController* )agent->GetController();
 	controller->ClearFocus( EAIFocusPriority::Gameplay );
+
+	// an agent leaving for any other reason than being let in must not be let in later
+	controller->GetAttackCircle()->LeaveAdmissionQueue( agent );
 }
@@ -1,12 +1,12 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #pragma once
-#include "State.h"
+#include "AIStateContext.h"
 
 /**
  * 
  */
-class DRAGOON_API AlertState : State
+class DRAGOON_API AlertState
 {
 protected:
 	// minimum distance to be maintained from player
@@ -18,26 +18,34 @@ protected:
 	// where the agent should be standing
 	FVector position;
 
+	// seconds between checks of whether the agent has drifted out of its preferred distance from the player
+	float standoffCheckInterval = 0.5f;
+
+	// seconds left until the next standoff check
+	float timeUntilStandoffCheck = 0;
+
+	// true while the agent is steering along the player's flow field toward position rather than following a path to it
+	bool bIsSteering = false;
+
 public:
 	AlertState();
 	~AlertState();
 
 	/**
-	* Sets up the focus to be the player and updates the blackboard to have the agent in combat.
+	* Sets up the focus to be the player, updates the blackboard to have the agent in combat and gets in line to join the attack circle.
 	* @param agent	The agent who is currently using this state for behavior.
 	*/
-	virtual void EnterState( AEnemyAgent* agent );
+	void EnterState( AEnemyAgent* agent );
 
 	/**
-	* Checks if the agent can join the attack circle. Makes the agent stay a preferred distance away from the player.
-	* @param agent	The agent who is currently using this state for behavior.
-	* @param deltaSeconds	The amount of time that has passed since the last tick of the game engine
+	* Makes the agent stay a preferred distance away from the player. The attack circle moves the agent on once it has been let in.
+	* @param context	The snapshot of the agent to read, and the commands to record into.
 	*/
-	virtual void StateTick( AEnemyAgent* agent, float deltaSeconds );
+	void StateTick( FAIStateContext& context );
 
 	/**
-	* Clears the focus of the agent.
+	* Clears the focus of the agent and takes it out of line to join the attack circle.
 	* @param agent	The agent who is currently using this state for behavior.
 	*/
-	virtual void ExitState( AEnemyAgent* agent );
+	void ExitState( AEnemyAgent* agent );
 };
@@ -2,6 +2,8 @@
 
 #include "Dragoon.h"
 #include "AttackCircle.h"
+#include "DragoonAIController.h"
+#include "AI/Navigation/NavigationSystem.h"
 
 AttackCircle::AttackCircle()
 {
@@ -14,6 +16,8 @@ AttackCircle::~AttackCircle()
 	// set pointers to null or remove references
 	player = nullptr;
 	circleSlotOccupant.Empty();
+	agentsWaitingForSlot.Empty();
+	admissionQueue.Empty();
 }
 
 AttackCircle::AttackCircle( ADragoonCharacter* playerCharacter ) {
@@ -24,11 +28,13 @@ AttackCircle::AttackCircle( ADragoonCharacter* playerCharacter ) {
 
 void AttackCircle::JoinCircle( AEnemyAgent* attacker ) {
 	// if attacker's score <= available enemy score
-	if ( attacker->GetEnemyScore() <= availableEnemyScore ) {
-		// add attacker to enemies in circle
-		AssignAgentToSlot( attacker, CheckForClosestAvailableSlot( attacker ) );
+	if ( CanAgentJoinCircle( attacker ) && !IsAgentInCircle( attacker ) ) {
+		// wait for the next auction to give the attacker a slot
+		agentsWaitingForSlot.Add( attacker );
 		// reduce available score by attacker's score
 		availableEnemyScore -= attacker->GetEnemyScore();
+		if ( sharedTokens )
+			sharedTokens->availableEnemyScore -= attacker->GetEnemyScore();
 		// add enemy to list of enemy's in circle
 		enemiesInCircle.Add( attacker );
 		// set enemy to be in combat
@@ -36,6 +42,26 @@ void AttackCircle::JoinCircle( AEnemyAgent* attacker ) {
 	}
 }
 
+void AttackCircle::EnqueueForAdmission( AEnemyAgent* agent ) {
+	if ( IsAgentInCircle( agent ) || admissionQueue.Contains( agent ) )
+		return;
+
+	// there may already be room, so look on the next tick
+	admissionQueue.Add( agent );
+	bAdmissionPending = true;
+}
+
+void AttackCircle::LeaveAdmissionQueue( AEnemyAgent* agent ) {
+	admissionQueue.Remove( agent );
+}
+
+TArray<AEnemyAgent*> AttackCircle::TakeAdmissionQueue() {
+	TArray<AEnemyAgent*> waitingAgents = MoveTemp( admissionQueue );
+	admissionQueue.Reset();
+	bAdmissionPending = false;
+	return waitingAgents;
+}
+
 void AttackCircle::UpdateCircleLocation() {
 	if ( !player )	// check if player has bee set
 		return;
@@ -43,15 +69,53 @@ void AttackCircle::UpdateCircleLocation() {
 	centerOfCircle = player->GetActorLocation();	// circle is centered on wherever the player is
 }
 
-void AttackCircle::RemoveAgentFromCircle( AEnemyAgent* agent ) {
-	// check for which slot agent belongs to and then remove them from it
-	for ( auto& slot : circleSlotOccupant ) {
-		if ( slot.Value == agent ) {
-			circleSlotOccupied[ slot.Key ] = false;	// set slot to be unoccupied
-			circleSlotOccupant.Remove( slot.Key );	// remove entry from occupant map
-			availableEnemyScore += agent->GetEnemyScore();
+void AttackCircle::Tick( float deltaSeconds ) {
+	// every slot location this frame is relative to where the player is now
+	UpdateCircleLocation();
+	UpdateSlotLocations( false );
+	RefreshNavCache();
+
+	// hand out attack score before slots so agents leaving the circle this frame have already given theirs back
+	circleTime += deltaSeconds;
+	ScheduleAttacks();
+
+	// let waiting agents in only when something has changed, so they can join this frame's auction
+	if ( bAdmissionPending )
+		AdmitWaitingAgents();
+
+	// start assigning the agents that have waited longest
+	if ( !slotAuction.IsRunning() ) {
+		if ( agentsWaitingForSlot.Num() == 0 )
 			return;
+		StartSlotAuction();
+	}
+
+	// spend this frame's budget, and hand out slots once every bidder has one. Blueprints can set the budget below the
+	// editor's minimum, and an auction given no bids would never finish
+	if ( slotAuction.IsRunning() && slotAuction.Run( FMath::Max( maxAssignmentBidsPerFrame, 1 ) ) )
+		FinishSlotAuction();
+}
+
+void AttackCircle::RemoveAgentFromCircle( AEnemyAgent* agent ) {
+	// look up which slot agent belongs to and then remove them from it
+	int32 slot = GetSlotIndex( agent );
+	int32 waitingIndex = slot < 0 ? agentsWaitingForSlot.Find( agent ) : INDEX_NONE;
+	if ( slot >= 0 || waitingIndex != INDEX_NONE ) {
+		if ( slot >= 0 )
+			ClearSlot( slot );	// set slot to be unoccupied
+		else {
+			// the auction's bidders are the first waiting agents, so it no longer matches them
+			if ( waitingIndex < slotAuction.GetNumBidders() )
+				slotAuction.Cancel();
+			agentsWaitingForSlot.RemoveAt( waitingIndex );
 		}
+		ReleaseAttacks( agent );	// an attack interrupted by death or leaving must not keep its score
+		enemiesInCircle.RemoveSingleSwap( agent );
+		bAdmissionPending = admissionQueue.Num() > 0;	// the freed score may let a waiting agent in
+		availableEnemyScore += agent->GetEnemyScore();
+		if ( sharedTokens )
+			sharedTokens->availableEnemyScore = FMath::Min( sharedTokens->availableEnemyScore + agent->GetEnemyScore(), sharedTokens->maxEnemyScore );
+		return;
 	}
 
 	// handling for agent not found
@@ -60,33 +124,57 @@ void AttackCircle::RemoveAgentFromCircle( AEnemyAgent* agent ) {
 
 FVector AttackCircle::GetLocationForAgent( AEnemyAgent* agent ) {
 	// check for which slot agent is assigned to and then return the location of that slot
-	if ( ( !circleSlotOccupant.FindKey( agent ) ) )
+	int32 slot = GetSlotIndex( agent );
+	if ( slot < 0 )
 		return agent->GetActorLocation();	// if requester is not assigned a slot, return its position
 
-	UpdateCircleLocation();	// update circle with player's latest location
-
-	// get which slot is assigned to requester
-	EAttackCircleSlot slot = *( circleSlotOccupant.FindKey( agent ) );
-
-	// return the center plus offset of slot
-	return centerOfCircle + *circleSlotOffset.Find( slot );
+	// slot locations are updated once per frame by Tick, and their height each time the player enters a new grid cell
+	FVector location = circleSlotLocation[ slot ];
+	location.Z = circleSlotNavHeight[ slot ];
+	return location;
 }
 
-bool AttackCircle::CanAgentPerformAttack( int attackScore ) {
-	if ( attackScore <= availableAttackScore ) {	// check if attack will be valid before allowing it
-		availableAttackScore -= attackScore;	// reduce available attack score
+bool AttackCircle::RequestAttack( AEnemyAgent* agent, int attackScore ) {
+	// only agents in a slot may attack, one attack at a time
+	if ( GetSlotIndex( agent ) < 0 )
+		return false;
+	for ( const FAttackLease& lease : attackLeases ) {
+		if ( lease.agent == agent )
+			return false;
+	}
+	for ( const FAttackRequest& request : attackRequests ) {
+		if ( request.agent == agent )
+			return false;
+	}
+
+	// go straight ahead if no one has been waiting and the score is available in this circle and across every circle
+	if ( attackRequests.Num() == 0 && TakeAttackScore( attackScore ) ) {
+		FAttackLease lease;
+		lease.agent = agent;
+		lease.attackScore = attackScore;
+		lease.expireTime = circleTime + attackLeaseSeconds;
+		attackLeases.Add( lease );
 		return true;
 	}
-	else
-		return false;
-}
 
-void AttackCircle::AgentAttackFinished( int attackScore ) {
-	availableAttackScore += attackScore;	// add the finished attack's score to the available score
+	// otherwise wait for the scheduler
+	FAttackRequest request;
+	request.agent = agent;
+	request.attackScore = attackScore;
+	request.requestTime = circleTime;
+	attackRequests.Add( request );
+	return false;
+}
 
-											// shouldn't happen, but checking just to ensure
-	if ( availableAttackScore > maxAttackScore )
-		availableAttackScore = maxAttackScore;
+void AttackCircle::AgentAttackFinished( AEnemyAgent* agent ) {
+	// give the leased score back. Nothing to do if the lease already expired
+	for ( int32 i = 0; i < attackLeases.Num(); i++ ) {
+		if ( attackLeases[ i ].agent == agent ) {
+			ReturnAttackScore( attackLeases[ i ].attackScore );
+			attackLeases.RemoveAtSwap( i );
+			return;
+		}
+	}
 }
 
 void AttackCircle::SetPlayer( ADragoonCharacter* newPlayer ) {
@@ -94,99 +182,284 @@ void AttackCircle::SetPlayer( ADragoonCharacter* newPlayer ) {
 }
 
 void AttackCircle::Initialize() {
+	// anyone in the circle has to join again
+	RemoveAllAgents();
+	attackLeases.Reset();
+	attackRequests.Reset();
 
 	// set available scores to max scores
 	availableEnemyScore = maxEnemyScore;
 	availableAttackScore = maxAttackScore;
 
-	// set up slots to not be occupied
-	circleSlotOccupied.Add( EAttackCircleSlot::ACS_Front, false );
-	circleSlotOccupied.Add( EAttackCircleSlot::ACS_FrontRight, false );
-	circleSlotOccupied.Add( EAttackCircleSlot::ACS_FrontLeft, false );
-	circleSlotOccupied.Add( EAttackCircleSlot::ACS_Left, false );
-	circleSlotOccupied.Add( EAttackCircleSlot::ACS_Right, false );
-	circleSlotOccupied.Add( EAttackCircleSlot::ACS_Back, false );
-	circleSlotOccupied.Add( EAttackCircleSlot::ACS_BackRight, false );
-	circleSlotOccupied.Add( EAttackCircleSlot::ACS_BackLeft, false );
-
-	// set up offset with vectors
-	circleSlotOffset.Add( EAttackCircleSlot::ACS_Front, FVector( 1, 0, 0 ) );
-	circleSlotOffset.Add( EAttackCircleSlot::ACS_FrontRight, FVector( 1, 1, 0 ) );
-	circleSlotOffset.Add( EAttackCircleSlot::ACS_FrontLeft, FVector( 1, -1, 0 ) );
-	circleSlotOffset.Add( EAttackCircleSlot::ACS_Left, FVector( 0, -1, 0 ) );
-	circleSlotOffset.Add( EAttackCircleSlot::ACS_Right, FVector( 0, 1, 0 ) );
-	circleSlotOffset.Add( EAttackCircleSlot::ACS_Back, FVector( -1, 0, 0 ) );
-	circleSlotOffset.Add( EAttackCircleSlot::ACS_BackRight, FVector( -1, 1, 0 ) );
-	circleSlotOffset.Add( EAttackCircleSlot::ACS_BackLeft, FVector( -1, -1, 0 ) );
-
-	// normalize vectors then multiply by the scale of the offset
-	for ( auto& pair : circleSlotOffset ) {
-		pair.Value.Normalize();
-		pair.Value *= offsetScale;
-		circleSlotOffset[ pair.Key ] = pair.Value;
+	// lay the slots out ring by ring. The inner ring's first 8 slots follow EAttackCircleSlot when it has 8 slots
+	numRings = FMath::Max( numRings, 1 );
+	slotsPerRing = FMath::Max( slotsPerRing, 1 );
+	circleSlotOffset.Reset( numRings * slotsPerRing );
+	for ( int32 ring = 0; ring < numRings; ring++ ) {
+		float radius = offsetScale + ring * ringSpacing;
+		float stagger = ( ring % 2 ) * 0.5f;	// offset every other ring by half a slot
+		for ( int32 i = 0; i < slotsPerRing; i++ ) {
+			float angle = 2.0f * PI * ( i + stagger ) / slotsPerRing;
+			circleSlotOffset.Add( FVector( FMath::Cos( angle ), FMath::Sin( angle ), 0 ) * radius );
+		}
 	}
 
+	// set up slots to not be occupied
+	circleSlotOccupant.Init( nullptr, circleSlotOffset.Num() );
+
 	// establish grid based on character position
 	UpdateCircleLocation();
+	circleSlotLocation.SetNum( circleSlotOffset.Num() );
+	circleSlotVersion.SetNumZeroed( circleSlotOffset.Num() );
+	UpdateSlotLocations( true );
+
+	// slots count as reachable until the first refresh has checked them
+	circleSlotNavigable.Init( true, circleSlotOffset.Num() );
+	circleSlotNavHeight.SetNum( circleSlotOffset.Num() );
+	for ( int32 slot = 0; slot < circleSlotOffset.Num(); slot++ )
+		circleSlotNavHeight[ slot ] = circleSlotLocation[ slot ].Z;
+	bNavCacheDirty = true;
+	RefreshNavCache();
+}
+
+void AttackCircle::RemoveAllAgents() {
+	while ( enemiesInCircle.Num() > 0 )
+		RemoveAgentFromCircle( enemiesInCircle.Last() );
 }
 
 void AttackCircle::GetNewSlotForAgent( AEnemyAgent* agent ) {
 	// if agent is not in circle, exit function
-	if ( !enemiesInCircle.Contains( agent ) )
+	int32 currentSlot = GetSlotIndex( agent );
+	if ( currentSlot < 0 )
 		return;
 
-	EAttackCircleSlot currentSlot = *circleSlotOccupant.FindKey( agent );
-	EAttackCircleSlot newSlot = CheckForClosestAvailableSlot( agent );
+	// stay in the current slot if every other slot is taken
+	int32 newSlot = CheckForClosestAvailableSlot( agent );
+	if ( newSlot < 0 )
+		return;
 
 	// remove from current slot
-	circleSlotOccupant.Remove( currentSlot );
-	circleSlotOccupied[ currentSlot ] = false;
+	ClearSlot( currentSlot );
 	
 	// setup agent in new slot
 	AssignAgentToSlot( agent, newSlot );
 }
 
 bool AttackCircle::CanAgentJoinCircle( AEnemyAgent* agent ) {
-	return agent->GetEnemyScore() <= availableEnemyScore;
+	return agent->GetEnemyScore() <= availableEnemyScore && ( !sharedTokens || agent->GetEnemyScore() <= sharedTokens->availableEnemyScore );
 }
 
-EAttackCircleSlot AttackCircle::CheckForClosestAvailableSlot( AEnemyAgent* requester ) {
+int32 AttackCircle::CheckForClosestAvailableSlot( AEnemyAgent* requester ) {
 	// setup local variables
 	FVector requesterLocation = requester->GetActorLocation();
-	EAttackCircleSlot bestSlot = EAttackCircleSlot::ACS_Front;
-	TArray<EAttackCircleSlot> freeSlots;
-	float bestDistance = NULL;	// start with a null distance
+	int32 bestSlot = -1;
+	float bestDistance = 0;
 
-	// get list of empty spots
-	for ( auto& Location : circleSlotOccupied ) {
-		// check TMap for empty slots to add to array
-		if ( !Location.Value )
-			freeSlots.Add( Location.Key );
-	}
-
-	float currentDistance;
 	// check empty slots for shortest distance to requester
-	for ( auto& slot : freeSlots ) {
+	for ( int32 slot = 0; slot < circleSlotOccupant.Num(); slot++ ) {
+		if ( !IsSlotAvailable( slot ) )
+			continue;
+
 		// calculate the distance squared
-		currentDistance = FVector::DistSquared( requesterLocation, centerOfCircle + circleSlotOffset[ slot ] );
+		float currentDistance = FVector::DistSquared( requesterLocation, centerOfCircle + circleSlotOffset[ slot ] );
 
-		if ( bestDistance == NULL ) {	// if bestDistance is null, this is the closest spot
-			bestDistance = currentDistance;
-			bestSlot = slot;
-		}
-		else if ( currentDistance < bestDistance ) {	// update best variables if current slot is closer than best slot
+		// update best variables if this is the first empty slot or it is closer than best slot
+		if ( bestSlot < 0 || currentDistance < bestDistance ) {
 			bestDistance = currentDistance;
 			bestSlot = slot;
 		}
 	}
 
-	freeSlots.Empty();	// destroy array when finished
-
 	// return the closest slot to requester
 	return bestSlot;
 }
 
-void AttackCircle::AssignAgentToSlot( AEnemyAgent* agent, EAttackCircleSlot slot ) {
-		circleSlotOccupant.Add( slot, agent );	// assign agent to slot
-		circleSlotOccupied[ slot ] = true;	// mark slot as occupied
+void AttackCircle::UpdateSlotLocations( bool bForce ) {
+	// versions keep counting up, even across Initialize, so an agent never mistakes a moved slot for the one it last walked to
+	float toleranceSquared = slotMoveTolerance * slotMoveTolerance;
+	for ( int32 slot = 0; slot < circleSlotOffset.Num(); slot++ ) {
+		FVector location = centerOfCircle + circleSlotOffset[ slot ];
+		if ( bForce || FVector::DistSquared( location, circleSlotLocation[ slot ] ) > toleranceSquared ) {
+			circleSlotLocation[ slot ] = location;
+			circleSlotVersion[ slot ]++;
+		}
+	}
+}
+
+void AttackCircle::RefreshNavCache() {
+	if ( !player )
+		return;
+
+	// small player movements keep the slots on the same bit of navmesh, so only look again once the player is in a new cell
+	FVector playerLocation = player->GetActorLocation();
+	float cellSize = FMath::Max( navGridCellSize, 1.0f );
+	FIntPoint cell( FMath::FloorToInt( playerLocation.X / cellSize ), FMath::FloorToInt( playerLocation.Y / cellSize ) );
+	if ( cell == navGridCell && !bNavCacheDirty )
+		return;
+	navGridCell = cell;
+	bNavCacheDirty = false;
+
+	UNavigationSystem* navSystem = player->GetWorld() ? player->GetWorld()->GetNavigationSystem() : nullptr;
+	if ( !navSystem )
+		return;
+
+	for ( int32 slot = 0; slot < circleSlotLocation.Num(); slot++ ) {
+		FNavLocation navLocation;
+		bool bNavigable = navSystem->ProjectPointToNavigation( circleSlotLocation[ slot ], navLocation ) && navLocation.Location.Z <= playerLocation.Z + maxSlotHeightAbovePlayer;
+		float height = bNavigable ? navLocation.Location.Z : circleSlotLocation[ slot ].Z;
+
+		// agents in the slot need to move if the ground under it has changed
+		if ( bNavigable != circleSlotNavigable[ slot ] || !FMath::IsNearlyEqual( height, circleSlotNavHeight[ slot ], slotMoveTolerance ) ) {
+			circleSlotNavigable[ slot ] = bNavigable;
+			circleSlotNavHeight[ slot ] = height;
+			circleSlotVersion[ slot ]++;
+		}
+	}
+}
+
+void AttackCircle::ScheduleAttacks() {
+	// take back the score of attacks that never reported finishing, such as ones interrupted before their animation ended
+	for ( int32 i = attackLeases.Num() - 1; i >= 0; i-- ) {
+		if ( attackLeases[ i ].expireTime <= circleTime ) {
+			ReturnAttackScore( attackLeases[ i ].attackScore );
+			attackLeases.RemoveAtSwap( i );
+		}
+	}
+
+	// grant waiting attacks in order of priority. Cheaper attacks go first, but every second waited makes an attack more important
+	while ( attackRequests.Num() > 0 ) {
+		int32 best = 0;
+		float bestPriority = 0;
+		for ( int32 i = 0; i < attackRequests.Num(); i++ ) {
+			float priority = ( circleTime - attackRequests[ i ].requestTime ) * attackPriorityAging - attackRequests[ i ].attackScore;
+			if ( i == 0 || priority > bestPriority ) {
+				bestPriority = priority;
+				best = i;
+			}
+		}
+
+		// drop the request if the agent can no longer make the attack. They will ask again when they are ready
+		FAttackRequest request = attackRequests[ best ];
+		if ( request.agent->GetIsDead() || request.agent->IsBusy() ) {
+			attackRequests.RemoveAt( best );
+			continue;
+		}
+
+		// nothing with a lower priority may skip ahead of the best request, or strong attacks could wait forever
+		if ( !TakeAttackScore( request.attackScore ) )
+			break;
+
+		attackRequests.RemoveAt( best );
+		FAttackLease lease;
+		lease.agent = request.agent;
+		lease.attackScore = request.attackScore;
+		lease.expireTime = circleTime + attackLeaseSeconds;
+		attackLeases.Add( lease );
+		request.agent->PerformAttack( request.attackScore );
+	}
+}
+
+void AttackCircle::ReleaseAttacks( AEnemyAgent* agent ) {
+	AgentAttackFinished( agent );
+	for ( int32 i = 0; i < attackRequests.Num(); i++ ) {
+		if ( attackRequests[ i ].agent == agent ) {
+			attackRequests.RemoveAt( i );
+			return;
+		}
+	}
+}
+
+bool AttackCircle::TakeAttackScore( int32 attackScore ) {
+	// check if attack will be valid before allowing it, both in this circle and across every circle
+	if ( attackScore > availableAttackScore || ( sharedTokens && attackScore > sharedTokens->availableAttackScore ) )
+		return false;
+
+	availableAttackScore -= attackScore;	// reduce available attack score
+	if ( sharedTokens )
+		sharedTokens->availableAttackScore -= attackScore;
+	return true;
+}
+
+void AttackCircle::ReturnAttackScore( int32 attackScore ) {
+	// leases make sure score is only returned once, so the available score never goes over the maximum
+	availableAttackScore += attackScore;
+	if ( sharedTokens )
+		sharedTokens->availableAttackScore += attackScore;
+}
+
+void AttackCircle::AdmitWaitingAgents() {
+	bAdmissionPending = false;
+
+	// agents that do not fit keep their place in line for the next time score is freed
+	for ( int32 i = 0; i < admissionQueue.Num() && availableEnemyScore > 0; ) {
+		AEnemyAgent* agent = admissionQueue[ i ];
+		if ( !CanAgentJoinCircle( agent ) ) {
+			i++;
+			continue;
+		}
+
+		admissionQueue.RemoveAt( i );
+		JoinCircle( agent );
+
+		// the controller moves the agent to attack once it has been let in
+		ADragoonAIController* controller = ( ADragoonAIController* )agent->GetController();
+		if ( controller )
+			controller->AgentAdmittedToCircle();
+	}
+}
+
+void AttackCircle::StartSlotAuction() {
+	// auction every free slot that can be reached
+	auctionSlots.Reset();
+	for ( int32 slot = 0; slot < circleSlotOccupant.Num(); slot++ ) {
+		if ( IsSlotAvailable( slot ) )
+			auctionSlots.Add( slot );
+	}
+
+	// the agents that have waited longest bid, as many as there are free slots
+	int32 numBidders = FMath::Min( agentsWaitingForSlot.Num(), auctionSlots.Num() );
+	if ( numBidders == 0 )
+		return;
+
+	// cost each pairing by how far the agent would have to travel, so the auction minimizes the total distance moved
+	TArray<float> costs;
+	costs.SetNumUninitialized( numBidders * auctionSlots.Num() );
+	for ( int32 bidder = 0; bidder < numBidders; bidder++ ) {
+		FVector agentLocation = agentsWaitingForSlot[ bidder ]->GetActorLocation();
+		for ( int32 i = 0; i < auctionSlots.Num(); i++ )
+			costs[ bidder * auctionSlots.Num() + i ] = FVector::Dist( agentLocation, centerOfCircle + circleSlotOffset[ auctionSlots[ i ] ] );
+	}
+
+	// bids only need to be fine enough to tell slots a few centimeters apart
+	slotAuction.Start( numBidders, auctionSlots.Num(), costs.GetData(), 1.0f );
+}
+
+void AttackCircle::FinishSlotAuction() {
+	int32 numBidders = slotAuction.GetNumBidders();
+	TArray<AEnemyAgent*> stillWaiting;
+	for ( int32 bidder = 0; bidder < numBidders; bidder++ ) {
+		AEnemyAgent* agent = agentsWaitingForSlot[ bidder ];
+		int32 slot = auctionSlots[ slotAuction.GetBidderSlot( bidder ) ];
+
+		// GetNewSlotForAgent may have taken the slot while the auction ran. The agent waits for the next auction
+		if ( circleSlotOccupant[ slot ] )
+			stillWaiting.Add( agent );
+		else
+			AssignAgentToSlot( agent, slot );
+	}
+
+	// agents that joined during the auction keep waiting behind any that missed out
+	stillWaiting.Append( agentsWaitingForSlot.GetData() + numBidders, agentsWaitingForSlot.Num() - numBidders );
+	agentsWaitingForSlot = MoveTemp( stillWaiting );
+	slotAuction.Cancel();
+}
+
+void AttackCircle::AssignAgentToSlot( AEnemyAgent* agent, int32 slot ) {
+	circleSlotOccupant[ slot ] = agent;	// assign agent to slot, which marks it as occupied
+	agent->SetCircleSlot( slot );	// remember the slot on the agent for constant time lookups
+}
+
+void AttackCircle::ClearSlot( int32 slot ) {
+	circleSlotOccupant[ slot ]->SetCircleSlot( -1 );
+	circleSlotOccupant[ slot ] = nullptr;
 }
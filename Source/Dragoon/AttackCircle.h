@@ -4,9 +4,10 @@
 
 #include "DragoonCharacter.h"
 #include "EnemyAgent.h"
+#include "SlotAuction.h"
 
 
-// enum for naming the 8 attack circle slots with regard to the player's orientation
+// enum for naming the 8 attack circle slots with regard to the player's orientation. Names the slots of the inner ring when it has 8 slots
 UENUM()
 enum class EAttackCircleSlot : uint8 {
 	ACS_Front,
@@ -19,6 +20,50 @@ enum class EAttackCircleSlot : uint8 {
 	ACS_FrontLeft
 };
 
+/**
+ * Enemy and attack scores shared by every attack circle, so the pressure on all players together stays bounded
+ * no matter how many circles there are.
+ */
+struct FAttackTokenPool {
+	// total enemy score that can be within all circles at any given moment
+	int32 maxEnemyScore = 0;
+
+	// total attack score that can be taking place within all circles at any given moment
+	int32 maxAttackScore = 0;
+
+	// scores not taken by any circle
+	int32 availableEnemyScore = 0;
+	int32 availableAttackScore = 0;
+};
+
+/**
+ * Attack score lent to an agent for one attack. Taken back when the attack finishes, the agent leaves the circle or the lease expires.
+ */
+struct FAttackLease {
+	// the agent making the attack
+	AEnemyAgent* agent;
+
+	// score of the attack
+	int32 attackScore;
+
+	// circle time the score is taken back at if the attack has not finished
+	float expireTime;
+};
+
+/**
+ * Attack waiting for enough attack score to become available.
+ */
+struct FAttackRequest {
+	// the agent wishing to attack
+	AEnemyAgent* agent;
+
+	// score of the attack
+	int32 attackScore;
+
+	// circle time the request was made at. Requests gain priority the longer they wait
+	float requestTime;
+};
+
 /**
  * 
  */
@@ -37,14 +82,53 @@ public:
 	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = AttackCircle )
 	float offsetScale = 150;
 
+	// Number of rings of slots around the player
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = AttackCircle )
+	int numRings = 1;
+
+	// Number of slots in each ring. Slots are spaced evenly starting in front of the player
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = AttackCircle )
+	int slotsPerRing = 8;
+
+	// Distance in cm between rings. Outer rings are offset by half a slot so agents can see past the ring in front of them
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = AttackCircle )
+	float ringSpacing = 150;
+
+	// Most auction bids spent assigning waiting agents to slots each frame. Bounds how long assignment can take in a single frame
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = AttackCircle, meta = ( ClampMin = "1" ) )
+	int maxAssignmentBidsPerFrame = 64;
+
+	// Seconds an attack's score is lent for. Taken back after this even if the attack never reports it has finished
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = AttackCircle )
+	float attackLeaseSeconds = 4.0f;
+
+	// Distance in cm a slot has to move before agents in it are told to move. Keeps agents from re-pathing on every small player movement
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = AttackCircle )
+	float slotMoveTolerance = 25.0f;
+
+	// Size in cm of the grid cells the player's location is snapped to. Slots are checked against the navmesh again each time the player enters a new cell
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = AttackCircle )
+	float navGridCellSize = 100.0f;
+
+	// Height in cm a slot's navmesh location may be above the player before the slot is considered unreachable
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = AttackCircle )
+	float maxSlotHeightAbovePlayer = 100.0f;
+
+	// How much a waiting attack's priority rises each second, in attack score. Lets strong attacks eventually go ahead of quick ones
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = AttackCircle )
+	float attackPriorityAging = 4.0f;
+
 private:
 	// The score available to place new enemies in the circle
 	UPROPERTY( VisibleAnywhere, Category = AttackCirlce )
-	int availableEnemyScore;
+	int availableEnemyScore = 0;
 
 	// The score available to start new attacks in the circle
 	UPROPERTY( VisibleAnywhere, Category = AttackCircle )
-	int availableAttackScore;
+	int availableAttackScore = 0;
+
+	// Scores shared with other circles. Taken from along with this circle's own scores. nullptr if the circle does not share
+	FAttackTokenPool* sharedTokens = nullptr;
 
 	// The origin of the attack circle which is based off the location of the player
 	FVector centerOfCircle;
@@ -57,17 +141,53 @@ private:
 	UPROPERTY( VisibleAnywhere, Category = AttackCircle )
 	TArray<AEnemyAgent*> enemiesInCircle;
 
-	// A hashtable for keeping the pointer for which enemy is in each slot. Is set to nullptr if no enemy is in slot.
-	UPROPERTY( VisibleAnywhere, Category = AttackCircle )
-	TMap<EAttackCircleSlot, AEnemyAgent*> circleSlotOccupant;
+	// Which enemy is in each slot, ring by ring starting with the inner ring. Is set to nullptr if no enemy is in slot.
+	TArray<AEnemyAgent*> circleSlotOccupant;
 
-	// A hashtable for keeping the offset values of the attack circle slots from the center of the circle
-	UPROPERTY( VisibleAnywhere, Category = AttackCircle )
-	TMap<EAttackCircleSlot, FVector> circleSlotOffset;
+	// The offset values of the attack circle slots from the center of the circle
+	TArray<FVector> circleSlotOffset;
 
-	// A hashtable for keeping if a slot is taken by an agent
-	UPROPERTY( VisibleAnywhere, Category = AttackCircle )
-	TMap<EAttackCircleSlot, bool> circleSlotOccupied;
+	// World location of each slot, updated once per frame. Only moved once the slot is further than slotMoveTolerance from it
+	TArray<FVector> circleSlotLocation;
+
+	// Goes up each time a slot's world location moves, so agents can tell their slot has moved without comparing locations
+	TArray<uint32> circleSlotVersion;
+
+	// Whether each slot was on the navmesh when the player last entered a new grid cell. Agents are never given a slot that is not
+	TArray<bool> circleSlotNavigable;
+
+	// Height of each slot's navmesh location when the player last entered a new grid cell. Slot locations use it so they sit on the ground
+	TArray<float> circleSlotNavHeight;
+
+	// Grid cell the player was in when the navmesh cache was last refreshed
+	FIntPoint navGridCell;
+
+	// Set when the navmesh cache has to be refreshed on the next tick whatever cell the player is in
+	bool bNavCacheDirty = true;
+
+	// Enemies that have joined the circle but are still waiting to be given a slot, in the order they joined
+	TArray<AEnemyAgent*> agentsWaitingForSlot;
+
+	// Auction assigning the first waiting agents to the free slots. Runs a few bids each frame
+	SlotAuction slotAuction;
+
+	// The slots being auctioned, in the order the auction numbers them
+	TArray<int32> auctionSlots;
+
+	// Attack score currently lent out. Each agent has at most one lease
+	TArray<FAttackLease> attackLeases;
+
+	// Attacks waiting for attack score. Each agent has at most one request
+	TArray<FAttackRequest> attackRequests;
+
+	// Seconds the circle has been ticked for. Lease and request times are measured with it
+	float circleTime = 0;
+
+	// Agents waiting to be let into the circle, in the order they asked
+	TArray<AEnemyAgent*> admissionQueue;
+
+	// Set when enemy score may have been freed or an agent started waiting. The queue is only looked at when this is set
+	bool bAdmissionPending = false;
 
 public:
 	AttackCircle();
@@ -95,17 +215,46 @@ public:
 	FORCEINLINE FVector GetCenterOfCircle() const { return centerOfCircle; }
 
 	/**
-	* Handles request from an attacker to join the attack circle
+	* Handles request from an attacker to join the attack circle. The attacker waits for a slot until the next auction assigns one.
 	* @param attacker	ADragoonCharacter that wants to be able to attack the player
 	*/
 	UFUNCTION( BlueprintCallable, Category = AttackCircle )
 	void JoinCircle( AEnemyAgent* attacker );
 
+	/**
+	* Puts an agent in line to join the circle. Once there is enough enemy score for it, the circle joins the agent itself
+	* and tells the agent's controller, so waiting agents do not need to keep asking.
+	* @param agent	the agent wishing to join
+	*/
+	void EnqueueForAdmission( AEnemyAgent* agent );
+
+	/**
+	* Takes an agent out of line to join the circle. Does nothing if the agent is not waiting
+	* @param agent	the agent that no longer wishes to join
+	*/
+	void LeaveAdmissionQueue( AEnemyAgent* agent );
+
+	/**
+	* Empties the admission queue and returns the agents that were waiting in it, in order
+	*/
+	TArray<AEnemyAgent*> TakeAdmissionQueue();
+
+	/**
+	* Has the circle look for agents to let in on its next tick. Called when enemy score shared with other circles is freed
+	*/
+	FORCEINLINE void NotifyEnemyScoreFreed() { bAdmissionPending = admissionQueue.Num() > 0; }
+
 	/**
 	* Sets centerOfCirlce to be the same as the player's location
 	*/
 	void UpdateCircleLocation();
 
+	/**
+	* Updates the circle's location and spends this frame's budget assigning waiting agents to slots. Called once per frame.
+	* @param deltaSeconds	time since the last tick
+	*/
+	void Tick( float deltaSeconds );
+
 	/**
 	* Sets the slot with the agent as an occupant to have a nullptr occupant.
 	* @param agent	Which ADragoonCharacter* you wish to remove from the attack circle
@@ -113,25 +262,45 @@ public:
 	void RemoveAgentFromCircle( AEnemyAgent* agent );
 
 	/**
-	* Returns the location of the slot to which an agent is assigned
+	* Returns true if the agent has a slot in the circle
+	* @param agent	the agent to check for
+	*/
+	FORCEINLINE bool IsAgentInCircle( const AEnemyAgent* agent ) const { return GetSlotIndex( agent ) >= 0 || agentsWaitingForSlot.Contains( agent ); }
+
+	/**
+	* Returns the location of the slot to which an agent is assigned. Agents still waiting for a slot get their own location.
 	* @param agent	ADragoonCharacter who needs to know their slot's location
 	*/
 	FVector GetLocationForAgent( AEnemyAgent* agent );
 
 	/**
-	* Checks if the agent's requested attack with score is able to be used currently.
+	* Returns the version of the slot's world location. Goes up whenever the slot moves further than slotMoveTolerance
+	* @param slot	index of the slot, as stored on the agent in it
+	*/
+	FORCEINLINE uint32 GetSlotVersion( int32 slot ) const { return circleSlotVersion.IsValidIndex( slot ) ? circleSlotVersion[ slot ] : 0; }
+
+	/**
+	* Returns true if the slot was on the navmesh when the player last entered a new grid cell
+	* @param slot	index of the slot, as stored on the agent in it
+	*/
+	FORCEINLINE bool IsSlotNavigable( int32 slot ) const { return circleSlotNavigable.IsValidIndex( slot ) && circleSlotNavigable[ slot ]; }
+
+	/**
+	* Asks to lease attack score for an attack. The lease is granted right away if the score is available and no one is waiting,
+	* otherwise the request waits and the circle starts the attack itself once the request's turn comes and the score is available.
+	* @param agent			The agent wishing to attack. Must be in the circle
 	* @param attackScore	The score associated with the attack an agent wishes to make
-	* @returns	Will return true if the attack can be made with the current available attack score, or false if it cannot be made
+	* @returns	Will return true if the attack can be made right away, or false if it has to wait or cannot be made
 	*/
 	UFUNCTION( BlueprintCallable, Category = AttackCircle )
-	bool CanAgentPerformAttack( int attackScore );
+	bool RequestAttack( AEnemyAgent* agent, int attackScore );
 
 	/**
-	* Returns the score from a finished attack back to the available attack score
-	* @param attackScore	The score associated with the attack that has completed
+	* Returns the score leased for an agent's finished attack back to the available attack score
+	* @param agent	The agent whose attack has completed
 	*/
 	UFUNCTION( BlueprintCallable, Category = AttackCircle )
-	void AgentAttackFinished( int attackScore );
+	void AgentAttackFinished( AEnemyAgent* agent );
 
 	/**
 	* Sets the player to the supplied pointer
@@ -139,6 +308,17 @@ public:
 	UFUNCTION( BlueprintCallable, Category = AttackCircle )
 	void SetPlayer( ADragoonCharacter* newPlayer );
 
+	/**
+	* Sets the pool of scores shared with other circles
+	* @param tokens	the shared pool, or nullptr to only use this circle's own scores
+	*/
+	FORCEINLINE void SetSharedTokens( FAttackTokenPool* tokens ) { sharedTokens = tokens; }
+
+	/**
+	* Removes every agent from the circle and gives their scores back
+	*/
+	void RemoveAllAgents();
+
 	/**
 	* Performs initial setup of member variables and TMaps. Requires player to be set before it will run.
 	*/
@@ -146,7 +326,7 @@ public:
 	void Initialize();
 
 	/**
-	 * Assigns a new slot to an agent already in the attack circle.
+	 * Assigns a new slot to an agent already in the attack circle. Takes the closest free slot right away rather than waiting for an auction.
 	 */
 	void GetNewSlotForAgent( AEnemyAgent* agent );
 
@@ -159,17 +339,87 @@ public:
 	bool CanAgentJoinCircle( AEnemyAgent* agent );
 
 private:
+	/**
+	* Returns the index of the slot the agent occupies, or -1 if the agent is not in this circle. Reads the slot index stored on the agent.
+	* @param agent	the agent whose slot is needed
+	*/
+	FORCEINLINE int32 GetSlotIndex( const AEnemyAgent* agent ) const {
+		int32 slot = agent->GetCircleSlot();
+		return slot >= 0 && slot < circleSlotOccupant.Num() && circleSlotOccupant[ slot ] == agent ? slot : -1;
+	}
+
+	/**
+	* Returns true if no one is in the slot and it can be reached on the navmesh
+	* @param slot	index of the slot to check
+	*/
+	FORCEINLINE bool IsSlotAvailable( int32 slot ) const { return !circleSlotOccupant[ slot ] && circleSlotNavigable[ slot ]; }
+
+	/**
+	* Empties a slot and clears the slot index stored on its occupant
+	* @param slot	index of the slot to empty
+	*/
+	void ClearSlot( int32 slot );
+
 	/**
 	* Compares the distance squared of all the empty attack circle slots and returns the closest one.
 	* @param requester	pointer to the enemy requesting to join the attack circle
-	* @return	returns the enum value for the closest, empty slot
+	* @return	returns the index of the closest, empty slot. -1 if every slot is taken
+	*/
+	int32 CheckForClosestAvailableSlot( AEnemyAgent* requester );
+
+	/**
+	* Moves the world location of every slot that has drifted further than slotMoveTolerance and bumps its version
+	* @param bForce	move every slot no matter how far it has drifted
+	*/
+	void UpdateSlotLocations( bool bForce );
+
+	/**
+	* Projects every slot onto the navmesh if the player has entered a new grid cell or the cache is dirty.
+	* Bumps the version of every slot whose navmesh height or navigability changed
+	*/
+	void RefreshNavCache();
+
+	/**
+	* Takes back leases that have expired and grants waiting requests in order of priority
+	*/
+	void ScheduleAttacks();
+
+	/**
+	* Takes back the lease and drops the request of an agent
+	* @param agent	the agent whose attack score should be returned
+	*/
+	void ReleaseAttacks( AEnemyAgent* agent );
+
+	/**
+	* Takes attack score from this circle and the shared pool, if both have enough
+	* @returns	true if the score was taken
+	*/
+	bool TakeAttackScore( int32 attackScore );
+
+	/**
+	* Gives attack score back to this circle and the shared pool
+	*/
+	void ReturnAttackScore( int32 attackScore );
+
+	/**
+	* Joins waiting agents to the circle in the order they asked, skipping any whose score does not fit, and tells their controllers
+	*/
+	void AdmitWaitingAgents();
+
+	/**
+	* Starts an auction between the agents that have waited longest and every free slot, costing each pairing by travel distance
+	*/
+	void StartSlotAuction();
+
+	/**
+	* Gives every agent in the finished auction the slot they won
 	*/
-	EAttackCircleSlot CheckForClosestAvailableSlot( AEnemyAgent* requester );
+	void FinishSlotAuction();
 
 	/**
-	* Sets circleSlotOccupant value for Key slot to be agent
+	* Sets circleSlotOccupant value for slot to be agent and stores the slot index on the agent
 	* @param agent	pointer to ADragoonCharacter that wants to join circle
-	* @param slot	The slot enum which is to be assigned
+	* @param slot	The index of the slot which is to be assigned
 	*/
-	void AssignAgentToSlot( AEnemyAgent* agent, EAttackCircleSlot slot );
+	void AssignAgentToSlot( AEnemyAgent* agent, int32 slot );
 };
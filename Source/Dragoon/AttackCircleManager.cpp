@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "AttackCircleManager.h"
+#include "DragoonAIController.h"
+
+AttackCircleManager::AttackCircleManager()
+{
+}
+
+AttackCircleManager::~AttackCircleManager()
+{
+	// remove every circle
+	circles.Empty();
+}
+
+AttackCircle* AttackCircleManager::AddPlayer( ADragoonCharacter* player ) {
+	// a player only ever has one circle
+	AttackCircle* freeCircle = nullptr;
+	bool bAnyPlayers = false;
+	for ( int32 i = 0; i < circles.Num(); i++ ) {
+		if ( circles[ i ].GetPlayer() == player )
+			return &circles[ i ];
+		if ( !circles[ i ].GetPlayer() && !freeCircle )
+			freeCircle = &circles[ i ];
+		bAnyPlayers |= circles[ i ].GetPlayer() != nullptr;
+	}
+
+	// fill the shared pool when the first player arrives
+	if ( !bAnyPlayers ) {
+		sharedTokens.maxEnemyScore = maxEnemyScore;
+		sharedTokens.maxAttackScore = maxAttackScore;
+		sharedTokens.availableEnemyScore = maxEnemyScore;
+		sharedTokens.availableAttackScore = maxAttackScore;
+	}
+
+	// reuse the circle of a player who has left, otherwise make a new one
+	if ( !freeCircle ) {
+		freeCircle = new AttackCircle();
+		circles.Add( freeCircle );
+	}
+	freeCircle->SetSharedTokens( &sharedTokens );
+	freeCircle->SetPlayer( player );
+	freeCircle->Initialize();
+	return freeCircle;
+}
+
+void AttackCircleManager::RemovePlayer( ADragoonCharacter* player ) {
+	for ( int32 i = 0; i < circles.Num(); i++ ) {
+		if ( circles[ i ].GetPlayer() == player ) {
+			TArray<AEnemyAgent*> fightingAgents = circles[ i ].GetEnemiesInCircle();
+			circles[ i ].RemoveAllAgents();
+			TArray<AEnemyAgent*> waitingAgents = circles[ i ].TakeAdmissionQueue();
+			circles[ i ].SetPlayer( nullptr );
+
+			// agents that were fighting have no slot left to attack from, so they go back to AlertState, which routes them to
+			// the nearest player left and gets them in line at that player's circle. With no player left they go back to
+			// guarding or patrolling, as they started
+			bool bAnyPlayers = false;
+			for ( int32 j = 0; j < circles.Num(); j++ )
+				bAnyPlayers |= circles[ j ].GetPlayer() != nullptr;
+			for ( AEnemyAgent* agent : fightingAgents ) {
+				ADragoonAIController* controller = ( ADragoonAIController* )agent->GetController();
+				if ( !controller )
+					continue;
+				if ( bAnyPlayers )
+					controller->SwapState( EAIStateType::AST_Alert );
+				else
+					controller->SwapState( agent->GetPatrolWaypoints().Num() == 0 ? EAIStateType::AST_Guard : EAIStateType::AST_Patrol );
+			}
+
+			// agents waiting to join get in line at the circle of the nearest player left
+			for ( AEnemyAgent* agent : waitingAgents ) {
+				AttackCircle* circle = RouteAgent( agent );
+				if ( circle )
+					circle->EnqueueForAdmission( agent );
+			}
+			return;
+		}
+	}
+}
+
+AttackCircle* AttackCircleManager::RouteAgent( AEnemyAgent* agent ) {
+	// agents in a circle keep fighting the player they are fighting
+	int32 currentIndex = agent->GetAttackCircleIndex();
+	if ( currentIndex >= 0 && currentIndex < circles.Num() && circles[ currentIndex ].GetPlayer() && circles[ currentIndex ].IsAgentInCircle( agent ) )
+		return &circles[ currentIndex ];
+
+	// find the nearest player
+	FVector agentLocation = agent->GetActorLocation();
+	int32 bestIndex = -1;
+	float bestDistance = 0;
+	for ( int32 i = 0; i < circles.Num(); i++ ) {
+		ADragoonCharacter* player = circles[ i ].GetPlayer();
+		if ( !player )
+			continue;
+
+		float distance = FVector::DistSquared( agentLocation, player->GetActorLocation() );
+		if ( bestIndex < 0 || distance < bestDistance ) {
+			bestDistance = distance;
+			bestIndex = i;
+		}
+	}
+
+	agent->SetAttackCircleIndex( bestIndex );
+	return bestIndex >= 0 ? &circles[ bestIndex ] : nullptr;
+}
+
+AttackCircle* AttackCircleManager::GetCircleForAgent( AEnemyAgent* agent ) {
+	// the index stored on the agent is all that is needed while its player is still around
+	int32 index = agent->GetAttackCircleIndex();
+	if ( index >= 0 && index < circles.Num() && circles[ index ].GetPlayer() )
+		return &circles[ index ];
+
+	return RouteAgent( agent );
+}
+
+void AttackCircleManager::RemoveAgent( AEnemyAgent* agent ) {
+	int32 index = agent->GetAttackCircleIndex();
+	if ( index < 0 || index >= circles.Num() )
+		return;
+
+	circles[ index ].LeaveAdmissionQueue( agent );
+	if ( circles[ index ].IsAgentInCircle( agent ) )
+		circles[ index ].RemoveAgentFromCircle( agent );
+}
+
+bool AttackCircleManager::IsPlayer( const AActor* actor ) const {
+	if ( !actor )
+		return false;
+
+	for ( int32 i = 0; i < circles.Num(); i++ ) {
+		if ( circles[ i ].GetPlayer() == actor )
+			return true;
+	}
+	return false;
+}
+
+void AttackCircleManager::Tick( float deltaSeconds ) {
+	// score freed by one circle may let agents waiting at another in
+	if ( sharedTokens.availableEnemyScore > lastAvailableEnemyScore ) {
+		for ( int32 i = 0; i < circles.Num(); i++ )
+			circles[ i ].NotifyEnemyScoreFreed();
+	}
+
+	for ( int32 i = 0; i < circles.Num(); i++ ) {
+		if ( circles[ i ].GetPlayer() )
+			circles[ i ].Tick( deltaSeconds );
+	}
+	lastAvailableEnemyScore = sharedTokens.availableEnemyScore;
+}
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "AttackCircle.h"
+
+/**
+ * Owns one attack circle per player and routes each agent to the circle of the nearest player.
+ * Every circle draws from one shared pool of enemy and attack scores, so adding players spreads the same pressure across them
+ * instead of multiplying it. Agents remember the index of their circle, so finding an agent's circle is constant time.
+ */
+class DRAGOON_API AttackCircleManager
+{
+public:
+	// Holds the maximum enemy score that can be within all circles together at any given moment
+	int maxEnemyScore = 20;
+
+	// Holds the maximum enemy attack score that can be taking place within all circles together at any given moment
+	int maxAttackScore = 20;
+
+private:
+	// One circle per player. Circles of players who have left are kept with no player so the indices agents hold stay valid
+	TIndirectArray<AttackCircle> circles;
+
+	// Scores shared by every circle
+	FAttackTokenPool sharedTokens;
+
+	// Shared enemy score available at the end of the last tick. Circles are told to look at their queues when it goes up
+	int32 lastAvailableEnemyScore = 0;
+
+public:
+	AttackCircleManager();
+	~AttackCircleManager();
+
+	// agents hold indices into the circles, so the manager cannot be copied
+	AttackCircleManager( const AttackCircleManager& ) = delete;
+	AttackCircleManager& operator=( const AttackCircleManager& ) = delete;
+
+	/**
+	 * Creates and initializes a circle around a player, reusing the circle of a player who has left if there is one.
+	 * @param player	the player to surround
+	 * @returns	the player's circle
+	 */
+	AttackCircle* AddPlayer( ADragoonCharacter* player );
+
+	/**
+	 * Removes every agent from a player's circle and frees the circle for another player. Agents that were in the circle
+	 * go back to AlertState, or to guarding or patrolling if no player is left. Agents waiting to join wait at the circle of
+	 * the nearest player left instead.
+	 * @param player	the player who is leaving
+	 */
+	void RemovePlayer( ADragoonCharacter* player );
+
+	/**
+	 * Routes an agent to the circle of the nearest player. Agents already in a circle stay in it.
+	 * @param agent	the agent to route
+	 * @returns	the agent's circle, or nullptr if there are no players
+	 */
+	AttackCircle* RouteAgent( AEnemyAgent* agent );
+
+	/**
+	 * Returns the circle an agent has been routed to, routing the agent first if it has not been or its player has left.
+	 * @param agent	the agent whose circle is needed
+	 */
+	AttackCircle* GetCircleForAgent( AEnemyAgent* agent );
+
+	/**
+	 * Takes an agent out of its circle and out of its circle's admission queue, without routing it anywhere
+	 * @param agent	the agent that has died or is leaving the game
+	 */
+	void RemoveAgent( AEnemyAgent* agent );
+
+	/**
+	 * Returns true if actor is one of the players being surrounded
+	 * @param actor	the actor to check
+	 */
+	bool IsPlayer( const AActor* actor ) const;
+
+	/**
+	 * Ticks every circle that has a player, first telling them if enemy score was freed in the shared pool
+	 * @param deltaSeconds	time since the last tick
+	 */
+	void Tick( float deltaSeconds );
+
+	/** Returns the number of circles, including ones without a player **/
+	FORCEINLINE int32 GetNumCircles() const { return circles.Num(); }
+	/** Returns the index-th circle **/
+	FORCEINLINE AttackCircle* GetCircle( int32 index ) { return &circles[ index ]; }
+	/** Returns sharedTokens **/
+	FORCEINLINE const FAttackTokenPool& GetSharedTokens() const { return sharedTokens; }
+};
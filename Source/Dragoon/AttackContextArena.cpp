@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "AttackNGram.h"
+#include "AttackContextArena.h"
+#include <cstring>
+
+AttackContextArena::AttackContextArena()
+{
+	// start with every free list empty
+	for ( int32 i = 0; i < NumSizeClasses; i++ )
+		freeTables[ i ] = nullptr;
+}
+
+AttackContextArena::~AttackContextArena()
+{
+	// give every page back to the heap. Any table still handed out becomes invalid
+	for ( uint8* page : pages )
+		delete[] page;
+	pages.clear();
+}
+
+FAttackContext* AttackContextArena::AllocateTable( int32 tableSize ) {
+	int32 sizeClass = GetSizeClass( tableSize );
+	int32 tableBytes = tableSize * ( int32 )sizeof( FAttackContext );
+	FAttackContext* table = freeTables[ sizeClass ];
+
+	if ( table ) {
+		// reuse a freed table of the same size. Its first bytes hold the next free table
+		std::memcpy( &freeTables[ sizeClass ], table, sizeof( FAttackContext* ) );
+	}
+	else if ( tableBytes > PageSize ) {
+		// large tables get a page of their own
+		uint8* page = new uint8[ tableBytes ];
+		pages.push_back( page );
+		reservedBytes += tableBytes;
+		table = ( FAttackContext* )page;
+	}
+	else {
+		// start a new page if the table does not fit in what is left of the current one
+		if ( tableBytes > pageRemaining ) {
+			pageCursor = new uint8[ PageSize ];
+			pageRemaining = PageSize;
+			pages.push_back( pageCursor );
+			reservedBytes += PageSize;
+		}
+		table = ( FAttackContext* )pageCursor;
+		pageCursor += tableBytes;
+		pageRemaining -= tableBytes;
+	}
+
+	// every slot of a new table must be empty
+	std::memset( table, 0, tableBytes );
+	bytesInUse += tableBytes;
+	return table;
+}
+
+void AttackContextArena::FreeTable( FAttackContext* table, int32 tableSize ) {
+	if ( !table )
+		return;
+
+	// push the table onto the front of the free list for its size
+	int32 sizeClass = GetSizeClass( tableSize );
+	std::memcpy( table, &freeTables[ sizeClass ], sizeof( FAttackContext* ) );
+	freeTables[ sizeClass ] = table;
+	bytesInUse -= tableSize * ( int32 )sizeof( FAttackContext );
+}
+
+int32 AttackContextArena::GetSizeClass( int32 tableSize ) {
+	// each size class is double the size of the one before it
+	int32 sizeClass = 0;
+	while ( ( MinTableSize << sizeClass ) < tableSize && sizeClass < NumSizeClasses - 1 )
+		sizeClass++;
+	return sizeClass;
+}
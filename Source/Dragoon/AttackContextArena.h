@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include <vector>
+
+struct FAttackContext;
+
+/**
+ * Arena that hands out the context tables used by AttackNGram.
+ * Memory is taken from the heap in large pages and tables are carved out of them. Freed tables are kept in a free list
+ * for their size so growing, clearing or replacing a model reuses memory instead of going back to the heap.
+ * Tables are only ever powers of two in size, which keeps the number of free lists small.
+ */
+class DRAGOON_API AttackContextArena
+{
+public:
+	// smallest table the arena hands out. Must be a power of two
+	static const int32 MinTableSize = 64;
+
+	// number of table sizes the arena keeps free lists for. The largest table is MinTableSize << ( NumSizeClasses - 1 )
+	static const int32 NumSizeClasses = 20;
+
+	// size in bytes of each page taken from the heap. Tables larger than a page get a page of their own
+	static const int32 PageSize = 256 * 1024;
+
+private:
+	// every page taken from the heap. Freed when the arena is destroyed
+	std::vector<uint8*> pages;
+
+	// next free byte of the current page
+	uint8* pageCursor = nullptr;
+
+	// bytes left in the current page
+	int32 pageRemaining = 0;
+
+	// head of the free list for each table size. Each free table stores the pointer to the next one in its first bytes
+	FAttackContext* freeTables[ NumSizeClasses ];
+
+	// bytes currently handed out as tables
+	int64 bytesInUse = 0;
+
+	// bytes taken from the heap for pages
+	int64 reservedBytes = 0;
+
+public:
+	AttackContextArena();
+	~AttackContextArena();
+
+	// the arena owns its pages so it cannot be copied
+	AttackContextArena( const AttackContextArena& ) = delete;
+	AttackContextArena& operator=( const AttackContextArena& ) = delete;
+
+	/**
+	 * Returns a zeroed table of tableSize contexts.
+	 * @param tableSize	number of contexts in the table. Must be a power of two of at least MinTableSize
+	 */
+	FAttackContext* AllocateTable( int32 tableSize );
+
+	/**
+	 * Returns a table to the arena so it can be handed out again.
+	 * @param table		table previously returned by AllocateTable
+	 * @param tableSize	number of contexts the table was allocated with
+	 */
+	void FreeTable( FAttackContext* table, int32 tableSize );
+
+	/** Returns bytesInUse **/
+	FORCEINLINE int64 GetBytesInUse() const { return bytesInUse; }
+	/** Returns the number of bytes taken from the heap **/
+	FORCEINLINE int64 GetBytesReserved() const { return reservedBytes; }
+
+private:
+	/**
+	 * Returns the free list index for a table size
+	 */
+	static int32 GetSizeClass( int32 tableSize );
+};
@@ -0,0 +1,212 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "AttackModelFile.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#if PLATFORM_WINDOWS
+#include "AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "HideWindowsPlatformTypes.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if PLATFORM_WINDOWS
+// converts a UTF-8 path to the wide string the Windows file functions take
+static std::wstring Utf8ToWide( const char* path ) {
+	int32 length = MultiByteToWideChar( CP_UTF8, 0, path, -1, nullptr, 0 );
+	std::wstring widePath( length > 0 ? length : 1, L'\0' );
+	if ( length > 0 )
+		MultiByteToWideChar( CP_UTF8, 0, path, -1, &widePath[ 0 ], length );
+	return widePath;
+}
+#endif
+
+AttackModelFile::AttackModelFile()
+{
+}
+
+AttackModelFile::~AttackModelFile()
+{
+	Close();
+}
+
+bool AttackModelFile::Open( const char* path ) {
+	Close();
+
+	// map the whole file read only
+#if PLATFORM_WINDOWS
+	HANDLE file = CreateFileW( Utf8ToWide( path ).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if ( file == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = nullptr;
+	if ( GetFileSizeEx( file, &fileSize ) && fileSize.QuadPart > 0 )
+		mapping = CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	CloseHandle( file );	// the mapping keeps the file open
+	if ( !mapping )
+		return false;
+
+	const void* data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	CloseHandle( mapping );	// the view keeps the mapping alive
+	if ( !data )
+		return false;
+	mappedSize = fileSize.QuadPart;
+#else
+	int file = open( path, O_RDONLY );
+	if ( file < 0 )
+		return false;
+
+	struct stat fileStats;
+	void* data = MAP_FAILED;
+	if ( fstat( file, &fileStats ) == 0 && fileStats.st_size > 0 )
+		data = mmap( nullptr, fileStats.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+	close( file );	// the mapping keeps the file open
+	if ( data == MAP_FAILED )
+		return false;
+	mappedSize = fileStats.st_size;
+#endif
+	mappedData = ( const uint8* )data;
+
+	// make sure the file is a model this build can use as is
+	const FAttackModelFileHeader* header = GetHeader();
+	bool bIsValid = mappedSize >= ( int64 )sizeof( FAttackModelFileHeader )
+		&& header->magic == Magic
+		&& header->version == Version
+		&& header->contextSize == sizeof( FAttackContext )
+		&& header->tableSize >= 1 && ( header->tableSize & ( header->tableSize - 1 ) ) == 0
+		&& header->numContexts < header->tableSize
+		&& mappedSize >= ( int64 )sizeof( FAttackModelFileHeader ) + ( int64 )header->tableSize * ( int64 )sizeof( FAttackContext );
+	if ( !bIsValid ) {
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void AttackModelFile::Close() {
+	if ( !mappedData )
+		return;
+
+#if PLATFORM_WINDOWS
+	UnmapViewOfFile( mappedData );
+#else
+	munmap( ( void* )mappedData, mappedSize );
+#endif
+	mappedData = nullptr;
+	mappedSize = 0;
+}
+
+bool AttackModelFile::Save( const char* path, AttackModelFile* prior, const AttackNGram* const* models, int32 numModels,
+	const FAttackContext* retired, int32 retiredTableSize, int32 numRetired ) {
+	// size the merged table so it is at most half full even if no contexts are shared. Open only checks the header, so the
+	// prior's contexts are counted from its table rather than trusted from the header
+	int64 maxContexts = retired ? numRetired : 0;
+	if ( prior && prior->IsOpen() ) {
+		const FAttackContext* priorContexts = prior->GetContexts();
+		for ( int32 slot = 0; slot < prior->GetTableSize(); slot++ ) {
+			if ( priorContexts[ slot ].key != 0 )
+				maxContexts++;
+		}
+	}
+	int32 maxOrder = prior && prior->IsOpen() ? ( int32 )prior->GetHeader()->maxOrder : 0;
+	for ( int32 i = 0; i < numModels; i++ ) {
+		maxContexts += models[ i ]->GetNumContexts();
+		if ( models[ i ]->GetMaxOrder() > maxOrder )
+			maxOrder = models[ i ]->GetMaxOrder();
+	}
+	int32 tableSize = AttackContextArena::MinTableSize;
+	while ( tableSize < maxContexts * 2 )
+		tableSize *= 2;
+
+	// merge the prior, the counts of models retired this session and every session model into one table
+	std::vector<FAttackContext> merged( tableSize, FAttackContext() );
+	int32 numMerged = 0;
+	if ( prior && prior->IsOpen() )
+		MergeContexts( merged.data(), tableSize, numMerged, prior->GetContexts(), prior->GetTableSize() );
+	if ( retired )
+		MergeContexts( merged.data(), tableSize, numMerged, retired, retiredTableSize );
+	for ( int32 i = 0; i < numModels; i++ )
+		MergeContexts( merged.data(), tableSize, numMerged, models[ i ]->GetContexts(), models[ i ]->GetContextCapacity() );
+
+	// the old file cannot be replaced while it is mapped
+	if ( prior )
+		prior->Close();
+
+	FAttackModelFileHeader header;
+	header.magic = Magic;
+	header.version = Version;
+	header.contextSize = sizeof( FAttackContext );
+	header.maxOrder = ( uint32 )maxOrder;
+	header.tableSize = ( uint32 )tableSize;
+	header.numContexts = ( uint32 )numMerged;
+	header.reserved = 0;
+
+	// write to a temporary file first so a failed save never leaves a broken model behind
+	std::string tempPath = std::string( path ) + ".tmp";
+#if PLATFORM_WINDOWS
+	FILE* file = _wfopen( Utf8ToWide( tempPath.c_str() ).c_str(), L"wb" );
+#else
+	FILE* file = fopen( tempPath.c_str(), "wb" );
+#endif
+	if ( !file )
+		return false;
+
+	bool bWritten = fwrite( &header, sizeof( header ), 1, file ) == 1
+		&& fwrite( merged.data(), sizeof( FAttackContext ), merged.size(), file ) == merged.size();
+	bWritten = fclose( file ) == 0 && bWritten;
+	if ( !bWritten ) {
+		remove( tempPath.c_str() );
+		return false;
+	}
+
+	// swap the new file in for the old one
+#if PLATFORM_WINDOWS
+	return MoveFileExW( Utf8ToWide( tempPath.c_str() ).c_str(), Utf8ToWide( path ).c_str(), MOVEFILE_REPLACE_EXISTING ) != 0;
+#else
+	return rename( tempPath.c_str(), path ) == 0;
+#endif
+}
+
+void AttackModelFile::MergeContexts( FAttackContext* merged, int32 mergedSize, int32& numMerged, const FAttackContext* source, int32 sourceSize ) {
+	for ( int32 slot = 0; slot < sourceSize; slot++ ) {
+		const FAttackContext& sourceContext = source[ slot ];
+		if ( sourceContext.key == 0 )
+			continue;
+
+		bool bAdded;
+		FAttackContext& context = *AttackNGram::FindOrAddContextInTable( merged, mergedSize, sourceContext.key, bAdded );
+		if ( bAdded )
+			numMerged++;
+
+		// add the counts together, halving the context until they fit
+		uint32 sums[ AttackNGram::NumAttacks ];
+		uint32 largest = 0;
+		for ( int32 i = 0; i < AttackNGram::NumAttacks; i++ ) {
+			sums[ i ] = ( uint32 )context.counts[ i ] + sourceContext.counts[ i ];
+			if ( sums[ i ] > largest )
+				largest = sums[ i ];
+		}
+		int32 shift = 0;
+		while ( ( largest >> shift ) > 0xFFFF )
+			shift++;
+
+		context.total = 0;
+		context.distinct = 0;
+		for ( int32 i = 0; i < AttackNGram::NumAttacks; i++ ) {
+			context.counts[ i ] = ( uint16 )( sums[ i ] >> shift );
+			context.recentCounts[ i ] = 0;	// recent history belongs to a session and is not saved
+			context.total += context.counts[ i ];
+			if ( context.counts[ i ] != 0 )
+				context.distinct++;
+		}
+	}
+}
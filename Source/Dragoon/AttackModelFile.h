@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "AttackNGram.h"
+
+/**
+ * Header at the start of an attack model file. The open addressed contexts table follows it directly,
+ * laid out exactly like AttackNGram's in memory table so it can be used straight out of the mapped file.
+ */
+struct FAttackModelFileHeader {
+	// identifies the file as an attack model. Also catches files written with a different byte order
+	uint32 magic;
+
+	// format version. Files with a different version are ignored
+	uint32 version;
+
+	// size of each context in bytes. Files written with a different context layout are ignored
+	uint32 contextSize;
+
+	// longest context order stored in the file
+	uint32 maxOrder;
+
+	// number of slots in the contexts table. Always a power of two
+	uint32 tableSize;
+
+	// number of slots in use in the contexts table
+	uint32 numContexts;
+
+	// keeps the table that follows 8 byte aligned
+	uint64 reserved;
+};
+
+/**
+ * Versioned binary file of attack patterns learned over earlier sessions.
+ * The file is memory mapped read only and its contexts table is handed to AttackNGram::SetPrior as is, so loading
+ * does no parsing and costs the same no matter how large the model grows. Pages are only read in as contexts are used.
+ * Save merges a session's counts into the prior and writes the result next to the old file before swapping it in.
+ */
+class DRAGOON_API AttackModelFile
+{
+public:
+	// "DRGM" read as a little endian uint32
+	static const uint32 Magic = 0x4D475244;
+
+	// current version of the file format. Increment when FAttackContext or the context key layout changes
+	static const uint32 Version = 1;
+
+private:
+	// start of the mapped file. nullptr if no file is open
+	const uint8* mappedData = nullptr;
+
+	// size of the mapped file in bytes
+	int64 mappedSize = 0;
+
+public:
+	AttackModelFile();
+
+	// Destructor that unmaps the file
+	~AttackModelFile();
+
+	// the mapping belongs to a single instance so it cannot be copied
+	AttackModelFile( const AttackModelFile& ) = delete;
+	AttackModelFile& operator=( const AttackModelFile& ) = delete;
+
+	/**
+	 * Memory maps a model file read only. Closes any file already open.
+	 * @param path	UTF-8 path of the file
+	 * @returns	true if the file exists and is a valid model of the current version
+	 */
+	bool Open( const char* path );
+
+	/**
+	 * Unmaps the file. Any N-gram using the contexts table as a prior must have it removed first.
+	 */
+	void Close();
+
+	/** Returns true if a file is mapped **/
+	FORCEINLINE bool IsOpen() const { return mappedData != nullptr; }
+	/** Returns the header of the mapped file **/
+	FORCEINLINE const FAttackModelFileHeader* GetHeader() const { return ( const FAttackModelFileHeader* )mappedData; }
+	/** Returns the contexts table of the mapped file **/
+	FORCEINLINE const FAttackContext* GetContexts() const { return mappedData ? ( const FAttackContext* )( mappedData + sizeof( FAttackModelFileHeader ) ) : nullptr; }
+	/** Returns the number of slots in the contexts table of the mapped file **/
+	FORCEINLINE int32 GetTableSize() const { return mappedData ? ( int32 )GetHeader()->tableSize : 0; }
+	/** Returns the number of contexts in the mapped file **/
+	FORCEINLINE int32 GetNumContexts() const { return mappedData ? ( int32 )GetHeader()->numContexts : 0; }
+
+	/**
+	 * Merges the counts of a prior file and a session's N-grams and writes them as a new model file.
+	 * The prior is closed once its counts are merged so the file it maps can be replaced.
+	 * @param path		UTF-8 path of the file to write
+	 * @param prior		currently open model file to merge the session into. May be nullptr
+	 * @param models	the session's N-grams. Recent history is not saved, only the counts
+	 * @param numModels	number of N-grams in models
+	 * @param retired	table of counts from models cleared earlier in the session, usually AttackModelPool's. May be nullptr
+	 * @param retiredTableSize	number of slots in retired
+	 * @param numRetired	number of contexts in retired
+	 * @returns	true if the file was written
+	 */
+	static bool Save( const char* path, AttackModelFile* prior, const AttackNGram* const* models, int32 numModels,
+		const FAttackContext* retired = nullptr, int32 retiredTableSize = 0, int32 numRetired = 0 );
+
+	/**
+	 * Adds every context of a table to a merged table, rescaling any context whose counts would overflow.
+	 * The merged table must have room for every context of the source that it doesn't have yet
+	 */
+	static void MergeContexts( FAttackContext* merged, int32 mergedSize, int32& numMerged, const FAttackContext* source, int32 sourceSize );
+};
@@ -0,0 +1,215 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "AttackModelPool.h"
+#include "AttackModelFile.h"
+#include <cstring>
+#include <new>
+
+// hashes an owner pointer into the owner index
+static FORCEINLINE uint32 HashOwner( const void* owner, uint32 mask ) {
+	uint64 key = ( uint64 )( UPTRINT )owner * 0x9E3779B97F4A7C15ull;
+	return ( uint32 )( key >> 32 ) & mask;
+}
+
+void FAttackModel::UpdateConfidence( int32 attackID ) {
+	// check if predicted attack is attack that was made
+	predictionConfidence = GetUpdatedConfidence( predictionConfidence, nextAttackPrediction == attackID );
+}
+
+float FAttackModel::GetUpdatedConfidence( float confidence, bool bWasPredicted ) {
+	if ( bWasPredicted ) {
+		// increase the confidence in the prediction algorithm
+		confidence += 0.05f;
+		// check to make sure confidence is within clamped range
+		if ( confidence > 0.95f )
+			confidence = 0.95f;
+	}
+	else {
+		// decrease the confidence in the prediction algorithm
+		confidence -= 0.01f;
+		// check to make sure confidence is within clamped range
+		if ( confidence > 0.5f )
+			confidence = 0.5f;
+	}
+	return confidence;
+}
+
+void FAttackModel::PredictNextAttack( float randomValue ) {
+	// make a weighted prediction from the blended probabilities of every context the history ends with
+	nextAttackPrediction = nGram.PredictAttack( randomValue );
+}
+
+void FAttackPredictionSnapshot::Publish( uint16 generation, uint8 sequence, int32 prediction, float confidence ) {
+	uint32 confidenceBits;
+	memcpy( &confidenceBits, &confidence, sizeof( confidenceBits ) );
+
+	// release so a reader that sees the new value also sees everything the publisher wrote before it
+	packed.store( ( ( uint64 )generation << 48 ) | ( ( uint64 )( uint8 )prediction << 40 ) | ( ( uint64 )sequence << 32 ) | confidenceBits, std::memory_order_release );
+}
+
+uint8 FAttackPredictionSnapshot::Read( uint16 generation, int32& outPrediction, float& outConfidence ) const {
+	uint64 value = packed.load( std::memory_order_acquire );
+	uint8 sequence = ( uint8 )( value >> 32 );
+	if ( value == 0 || ( uint16 )( value >> 48 ) != generation || sequence == 0 ) {
+		outPrediction = FAttackModel::InitialPrediction;
+		outConfidence = FAttackModel::InitialConfidence;
+		return 0;
+	}
+
+	uint32 confidenceBits = ( uint32 )value;
+	memcpy( &outConfidence, &confidenceBits, sizeof( outConfidence ) );
+	outPrediction = ( int32 )( ( value >> 40 ) & 0xFF );
+	return sequence;
+}
+
+AttackModelPool::AttackModelPool( int32 order, int32 maxHistory, float weight )
+{
+	modelOrder = order;
+	modelHistorySize = maxHistory;
+	modelHistoryWeight = weight;
+
+	// start with an empty index
+	for ( int32 i = 0; i < OwnerIndexSize; i++ )
+		ownerIndex[ i ] = -1;
+}
+
+AttackModelPool::~AttackModelPool()
+{
+	// models return their tables to the arena, so they have to be destroyed before it is
+	for ( int32 i = 0; i < numModels; i++ )
+		GetModelAt( i ).~FAttackModel();
+	numModels = 0;
+}
+
+FAttackModel& AttackModelPool::GetModel( const void* owner ) {
+	useCounter++;
+
+	// use the owner's model if it already has one
+	int32 slot = FindOwnerSlot( owner );
+	if ( ownerIndex[ slot ] != -1 ) {
+		FAttackModel& model = GetModelAt( ownerIndex[ slot ] );
+		model.lastUsed = useCounter;
+		return model;
+	}
+
+	// look for a model no one owns
+	int32 modelIndex = -1;
+	for ( int32 i = 0; i < numModels; i++ ) {
+		if ( !GetModelAt( i ).owner ) {
+			modelIndex = i;
+			break;
+		}
+	}
+
+	if ( modelIndex == -1 && numModels < MaxModels ) {
+		// construct a new model in the next free piece of storage
+		modelIndex = numModels++;
+		new ( modelStorage[ modelIndex ] ) FAttackModel( &arena, modelOrder, modelHistorySize, modelHistoryWeight );
+		GetModelAt( modelIndex ).nGram.SetPrior( priorContexts, priorTableSize );
+	}
+	else if ( modelIndex == -1 ) {
+		// every model is in use, so replace the least recently used one
+		modelIndex = 0;
+		for ( int32 i = 1; i < numModels; i++ ) {
+			if ( GetModelAt( i ).lastUsed < GetModelAt( modelIndex ).lastUsed )
+				modelIndex = i;
+		}
+		RetireModel( GetModelAt( modelIndex ) );
+		ClearModel( GetModelAt( modelIndex ) );
+		GetModelAt( modelIndex ).owner = nullptr;
+		RebuildOwnerIndex();
+		slot = FindOwnerSlot( owner );
+	}
+
+	// give the model to its new owner
+	FAttackModel& model = GetModelAt( modelIndex );
+	model.owner = owner;
+	model.lastUsed = useCounter;
+	ownerIndex[ slot ] = ( int8 )modelIndex;
+	return model;
+}
+
+FAttackModel* AttackModelPool::FindModel( const void* owner ) {
+	int32 slot = FindOwnerSlot( owner );
+	return ownerIndex[ slot ] != -1 ? &GetModelAt( ownerIndex[ slot ] ) : nullptr;
+}
+
+void AttackModelPool::RemoveModel( const void* owner ) {
+	FAttackModel* model = FindModel( owner );
+	if ( !model )
+		return;
+
+	// clear the model and leave it unowned so the next new attacker can use it
+	RetireModel( *model );
+	ClearModel( *model );
+	model->owner = nullptr;
+	RebuildOwnerIndex();
+}
+
+void AttackModelPool::Reset() {
+	for ( int32 i = 0; i < numModels; i++ ) {
+		ClearModel( GetModelAt( i ) );
+		GetModelAt( i ).owner = nullptr;
+	}
+	RebuildOwnerIndex();
+	retiredContexts.clear();
+	numRetired = 0;
+}
+
+void AttackModelPool::SetPrior( const FAttackContext* table, int32 tableSize ) {
+	priorContexts = table;
+	priorTableSize = tableSize;
+
+	// clearing a model keeps its prior, so only constructed models need updating
+	for ( int32 i = 0; i < numModels; i++ )
+		GetModelAt( i ).nGram.SetPrior( table, tableSize );
+}
+
+int32 AttackModelPool::FindOwnerSlot( const void* owner ) const {
+	uint32 mask = OwnerIndexSize - 1;
+	uint32 slot = HashOwner( owner, mask );
+
+	// probe until the owner or an empty slot is found. The index is never full as it is larger than MaxModels
+	while ( ownerIndex[ slot ] != -1 && ( ( FAttackModel* )modelStorage[ ownerIndex[ slot ] ] )->owner != owner )
+		slot = ( slot + 1 ) & mask;
+	return ( int32 )slot;
+}
+
+void AttackModelPool::RebuildOwnerIndex() {
+	for ( int32 i = 0; i < OwnerIndexSize; i++ )
+		ownerIndex[ i ] = -1;
+
+	// put every owned model back in the index
+	for ( int32 i = 0; i < numModels; i++ ) {
+		if ( GetModelAt( i ).owner )
+			ownerIndex[ FindOwnerSlot( GetModelAt( i ).owner ) ] = ( int8 )i;
+	}
+}
+
+void AttackModelPool::RetireModel( const FAttackModel& model ) {
+	if ( model.nGram.GetNumContexts() == 0 )
+		return;
+
+	// grow the table first if the model's contexts could fill more than half of it
+	int32 tableSize = retiredContexts.empty() ? AttackContextArena::MinTableSize : ( int32 )retiredContexts.size();
+	while ( tableSize < ( numRetired + model.nGram.GetNumContexts() ) * 2 )
+		tableSize *= 2;
+	if ( tableSize != ( int32 )retiredContexts.size() ) {
+		std::vector<FAttackContext> grown( tableSize, FAttackContext() );
+		int32 numGrown = 0;
+		if ( !retiredContexts.empty() )
+			AttackModelFile::MergeContexts( grown.data(), tableSize, numGrown, retiredContexts.data(), ( int32 )retiredContexts.size() );
+		retiredContexts.swap( grown );
+		numRetired = numGrown;
+	}
+
+	AttackModelFile::MergeContexts( retiredContexts.data(), tableSize, numRetired, model.nGram.GetContexts(), model.nGram.GetContextCapacity() );
+}
+
+void AttackModelPool::ClearModel( FAttackModel& model ) {
+	model.nGram.Reset();
+	model.predictionConfidence = FAttackModel::InitialConfidence;
+	model.nextAttackPrediction = FAttackModel::InitialPrediction;
+	model.lastUsed = 0;
+}
@@ -0,0 +1,214 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "AttackNGram.h"
+#include <atomic>
+#include <vector>
+
+/**
+ * Prediction state for one attacker. Holds the attacker's N-gram along with the prediction made from it.
+ */
+struct FAttackModel {
+	// the attacker this model belongs to. nullptr if the model is unused
+	const void* owner;
+
+	// N-gram of this attacker's attack patterns
+	AttackNGram nGram;
+
+	// the probability of an unknown or random attack
+	float predictionConfidence;
+
+	// what attack is predicted. Uses the ID system of attacks as its value
+	int32 nextAttackPrediction;
+
+	// value of the pool's use counter the last time this model was used. Least recently used models are replaced first
+	uint32 lastUsed;
+
+	// confidence and prediction of a model that has not seen any attacks
+	static constexpr float InitialConfidence = 0.8f;
+	static const int32 InitialPrediction = 0;
+
+	FAttackModel( AttackContextArena* arena, int32 order, int32 maxHistory, float weight )
+		: owner( nullptr ), nGram( arena, order, maxHistory, weight ), predictionConfidence( InitialConfidence ), nextAttackPrediction( InitialPrediction ), lastUsed( 0 ) {}
+
+	/**
+	 * Returns what the confidence becomes after an attack is made.
+	 * @param confidence		the confidence before the attack
+	 * @param bWasPredicted		true if the attack made was the predicted one
+	 */
+	static float GetUpdatedConfidence( float confidence, bool bWasPredicted );
+
+	/**
+	 * Raises the confidence if the attack made was the predicted one, and lowers it otherwise.
+	 * @param attackID	the ID of the attack that was made
+	 */
+	void UpdateConfidence( int32 attackID );
+
+	/**
+	 * Predicts the next attack from the N-gram and stores it in nextAttackPrediction.
+	 * @param randomValue	uniform random value in [0, 1) used to make the prediction
+	 */
+	void PredictNextAttack( float randomValue );
+};
+
+/**
+ * Latest prediction and confidence of one attacker's model, packed into a single atomic so the thread updating the model
+ * can publish it and other threads can read it without locking or seeing half of an update. Only one thread may publish.
+ */
+struct DRAGOON_API FAttackPredictionSnapshot {
+private:
+	// generation in the top 16 bits, then the prediction, the sequence and the confidence's bits in the low 32 bits. 0 if nothing was published
+	std::atomic<uint64> packed;
+
+public:
+	FAttackPredictionSnapshot() : packed( 0 ) {}
+
+	/**
+	 * Publishes a new prediction.
+	 * @param generation	identifies who the prediction is for. Readers asking for another generation ignore it
+	 * @param sequence		incremented by the publisher for each prediction so readers can tell when a new one arrives
+	 * @param prediction	the predicted attack ID
+	 * @param confidence	confidence in the prediction
+	 */
+	void Publish( uint16 generation, uint8 sequence, int32 prediction, float confidence );
+
+	/**
+	 * Reads the latest prediction. Falls back to the prediction of a model that has not seen any attacks if nothing has been
+	 * published for generation yet.
+	 * @param generation		generation the prediction must have been published with
+	 * @param outPrediction		the predicted attack ID
+	 * @param outConfidence		confidence in the prediction
+	 * @returns	the sequence of the prediction, or 0 if nothing has been published for generation
+	 */
+	uint8 Read( uint16 generation, int32& outPrediction, float& outConfidence ) const;
+};
+
+/**
+ * Fixed size pool of attack prediction models keyed by attacker, so every attacker in a level keeps their own patterns.
+ * Models are stored inline and their context tables come from one shared arena, so adding an attacker or clearing a model
+ * never allocates per context. Attackers are found through a small open addressed index in constant time.
+ * When every model is in use, the least recently used model is cleared and given to the new attacker.
+ * The counts of a model that is cleared or removed are merged into a table of retired counts first, so they still get saved.
+ */
+class DRAGOON_API AttackModelPool
+{
+public:
+	// maximum number of attackers that can have a model at the same time
+	static const int32 MaxModels = 8;
+
+private:
+	// number of slots in the owner index. Power of two, kept well above MaxModels so probes stay short
+	static const int32 OwnerIndexSize = 32;
+
+	// arena every model's context table is allocated from
+	AttackContextArena arena;
+
+	// inline storage for the models. Only the first numModels are constructed
+	alignas( FAttackModel ) uint8 modelStorage[ MaxModels ][ sizeof( FAttackModel ) ];
+
+	// number of models that have been constructed in modelStorage
+	int32 numModels = 0;
+
+	// open addressed index from owner to model. -1 marks an empty slot
+	int8 ownerIndex[ OwnerIndexSize ];
+
+	// incremented every time a model is used. Used to find the least recently used model
+	uint32 useCounter = 0;
+
+	// read only table of contexts learned in earlier sessions, shared by every model. nullptr if there is no prior
+	const FAttackContext* priorContexts = nullptr;
+
+	// number of slots in the prior table
+	int32 priorTableSize = 0;
+
+	// open addressed table of the counts of every model cleared since the pool was last reset. Empty until a model is cleared
+	std::vector<FAttackContext> retiredContexts;
+
+	// number of contexts in retiredContexts
+	int32 numRetired = 0;
+
+	// settings every model's N-gram is created with
+	int32 modelOrder;
+	int32 modelHistorySize;
+	float modelHistoryWeight;
+
+public:
+	/**
+	 * Creates an empty pool.
+	 * @param order			how many previous attacks the longest context of each model uses
+	 * @param maxHistory	how many recent attacks each model weights more heavily
+	 * @param weight		how much each model multiplies a sequence in the recent history by
+	 */
+	AttackModelPool( int32 order = 4, int32 maxHistory = 50, float weight = 2 );
+
+	// Destructor that destroys every constructed model.
+	~AttackModelPool();
+
+	// the models point into the pool's own arena so it cannot be copied
+	AttackModelPool( const AttackModelPool& ) = delete;
+	AttackModelPool& operator=( const AttackModelPool& ) = delete;
+
+	/**
+	 * Returns the model belonging to owner. Gives owner a model if it does not have one.
+	 * @param owner	the attacker whose model is needed
+	 */
+	FAttackModel& GetModel( const void* owner );
+
+	/**
+	 * Returns the model belonging to owner, or nullptr if owner does not have one.
+	 * @param owner	the attacker whose model is needed
+	 */
+	FAttackModel* FindModel( const void* owner );
+
+	/**
+	 * Clears the model belonging to owner and frees it for another attacker.
+	 * @param owner	the attacker whose model should be removed
+	 */
+	void RemoveModel( const void* owner );
+
+	/**
+	 * Clears every model and forgets the retired counts.
+	 */
+	void Reset();
+
+	/**
+	 * Sets a table of contexts learned in earlier sessions as the prior of every model, including ones created later.
+	 * @param table		open addressed contexts table, usually from a mapped AttackModelFile. nullptr to remove the prior
+	 * @param tableSize	number of slots in the table
+	 */
+	void SetPrior( const FAttackContext* table, int32 tableSize );
+
+	/** Returns numModels **/
+	FORCEINLINE int32 GetNumModels() const { return numModels; }
+	/** Returns the model stored at index **/
+	FORCEINLINE FAttackModel& GetModelAt( int32 index ) { return *( FAttackModel* )modelStorage[ index ]; }
+	/** Returns arena **/
+	FORCEINLINE const AttackContextArena& GetArena() const { return arena; }
+	/** Returns the table of retired counts, or nullptr if no model has been cleared **/
+	FORCEINLINE const FAttackContext* GetRetiredContexts() const { return retiredContexts.empty() ? nullptr : retiredContexts.data(); }
+	/** Returns the number of slots in the table of retired counts **/
+	FORCEINLINE int32 GetRetiredTableSize() const { return ( int32 )retiredContexts.size(); }
+	/** Returns numRetired **/
+	FORCEINLINE int32 GetNumRetired() const { return numRetired; }
+
+private:
+	/**
+	 * Returns the slot of the owner index where owner is stored or should be stored
+	 */
+	int32 FindOwnerSlot( const void* owner ) const;
+
+	/**
+	 * Rebuilds the owner index from the models. Used when a model changes owner.
+	 */
+	void RebuildOwnerIndex();
+
+	/**
+	 * Merges a model's counts into the table of retired counts, growing it so it stays at most half full
+	 */
+	void RetireModel( const FAttackModel& model );
+
+	/**
+	 * Clears a model's N-gram and prediction so it can be given to a new owner
+	 */
+	static void ClearModel( FAttackModel& model );
+};
@@ -0,0 +1,309 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "AttackNGram.h"
+
+// hashes a context key into the contexts table
+static FORCEINLINE uint32 HashContextKey( uint64 key, uint32 mask ) {
+	key *= 0x9E3779B97F4A7C15ull;
+	return ( uint32 )( key ^ ( key >> 32 ) ) & mask;
+}
+
+AttackNGram::AttackNGram( AttackContextArena* contextArena, int32 order, int32 maxHistory, float weight )
+{
+	arena = contextArena;
+
+	// clamp settings to what the table and history can store
+	maxOrder = order < 0 ? 0 : ( order > MaxSupportedOrder ? MaxSupportedOrder : order );
+	historySize = maxHistory < maxOrder + 1 ? maxOrder + 1 : ( maxHistory > MaxHistorySize ? MaxHistorySize : maxHistory );
+	historyWeight = weight > 0 ? weight : 1;
+
+	// precompute the history weight for every amount of times a sequence can appear in the history. Capped so a large weight
+	// or a long history can't overflow to infinity and turn the probabilities into NaN
+	float power = 1;
+	for ( int32 i = 0; i <= historySize; i++ ) {
+		historyWeightPowers[ i ] = power;
+		power = power * historyWeight < MaxHistoryWeightPower ? power * historyWeight : MaxHistoryWeightPower;
+	}
+
+	Reset();
+}
+
+AttackNGram::~AttackNGram()
+{
+	// give the table back to the arena
+	arena->FreeTable( contexts, contextCapacity );
+	contexts = nullptr;
+}
+
+void AttackNGram::RecordAttack( int32 attackID ) {
+	// remove oldest entry if history is full. Every sequence starting at the oldest attack leaves the recent window
+	if ( historyCount == historySize ) {
+		for ( int32 order = 0; order <= maxOrder && order < historyCount; order++ ) {
+			FAttackContext* context = FindOrAddContext( MakeContextKey( order, order ) );
+			context->recentCounts[ GetHistoryAttack( order ) ]--;
+			context->version++;
+		}
+		historyStart = ( historyStart + 1 ) % historySize;
+		historyCount--;
+	}
+
+	// count the attack for every context the history currently ends with. These also enter the recent window
+	for ( int32 order = 0; order <= maxOrder && order <= historyCount; order++ ) {
+		FAttackContext* context = FindOrAddContext( MakeContextKey( historyCount, order ) );
+		if ( context->counts[ attackID ] == 0xFFFF )
+			RescaleContext( *context );
+		if ( context->counts[ attackID ] == 0 )
+			context->distinct++;
+		context->counts[ attackID ]++;
+		context->total++;
+		context->recentCounts[ attackID ]++;
+		context->version++;
+	}
+
+	// add new attack to back of history
+	attackHistory[ ( historyStart + historyCount ) % historySize ] = ( uint8 )attackID;
+	historyCount++;
+}
+
+void AttackNGram::GetPrediction( float* outProbabilities ) const {
+	// with no information every attack is equally likely
+	for ( int32 i = 0; i < NumAttacks; i++ )
+		outProbabilities[ i ] = 1.0f / NumAttacks;
+
+	// blend in each context from shortest to longest. Unseen attacks in a context escape to the shorter context's probability
+	float weights[ NumAttacks ];
+	for ( int32 order = 0; order <= maxOrder && order <= historyCount; order++ ) {
+		uint64 key = MakeContextKey( historyCount, order );
+		const FAttackContext* context = FindContextInTable( contexts, contextCapacity, key );
+		const FAttackContext* priorContext = priorContexts ? FindContextInTable( priorContexts, priorCapacity, key ) : nullptr;
+		if ( !context && !priorContext )
+			break;	// longer contexts cannot have been seen if this one has not
+
+		float totalWeight;
+		int32 distinct = GetContextWeights( context, priorContext, weights, totalWeight );
+		if ( distinct == 0 )
+			break;
+
+		float escape = ( float )distinct;
+		float normalizer = 1.0f / ( totalWeight + escape );
+		for ( int32 i = 0; i < NumAttacks; i++ )
+			outProbabilities[ i ] = ( weights[ i ] + escape * outProbabilities[ i ] ) * normalizer;
+	}
+}
+
+int32 AttackNGram::PredictAttack( float randomValue ) const {
+	// find every context the history ends with, up to the longest one that has been seen
+	const FAttackContext* chain[ MaxSupportedOrder + 1 ];
+	const FAttackContext* priorChain[ MaxSupportedOrder + 1 ];
+	uint64 keys[ MaxSupportedOrder + 1 ];
+	int32 longestOrder = -1;
+	for ( int32 order = 0; order <= maxOrder && order <= historyCount; order++ ) {
+		keys[ order ] = MakeContextKey( historyCount, order );
+		chain[ order ] = FindContextInTable( contexts, contextCapacity, keys[ order ] );
+		priorChain[ order ] = priorContexts ? FindContextInTable( priorContexts, priorCapacity, keys[ order ] ) : nullptr;
+		if ( !chain[ order ] && !priorChain[ order ] )
+			break;	// longer contexts cannot have been seen if this one has not
+		longestOrder = order;
+	}
+
+	// draw from the longest context, escaping to shorter ones. The random value is rescaled at each step so one value is enough
+	double value = randomValue;
+	for ( int32 order = longestOrder; order >= 0; order-- ) {
+		const FAttackAliasTable& table = GetAliasTable( keys[ order ], chain[ order ], priorChain[ order ] );
+		if ( value < table.keepProbability ) {
+			// pick a column, then either its own attack or its alias
+			double column = value / table.keepProbability * NumAttacks;
+			int32 index = ( int32 )column;
+			if ( index >= NumAttacks )
+				index = NumAttacks - 1;
+			return column - index < table.probability[ index ] ? index : table.alias[ index ];
+		}
+		value = ( value - table.keepProbability ) / ( 1.0 - table.keepProbability );
+	}
+
+	// escaped every context, so every attack is equally likely
+	int32 index = ( int32 )( value * NumAttacks );
+	return index < NumAttacks ? index : NumAttacks - 1;
+}
+
+void AttackNGram::Reset() {
+	// empty the table back to its starting size
+	arena->FreeTable( contexts, contextCapacity );
+	contextCapacity = AttackContextArena::MinTableSize;
+	contexts = arena->AllocateTable( contextCapacity );
+	numContexts = 0;
+
+	// empty the history
+	historyStart = 0;
+	historyCount = 0;
+
+	ClearAliasCache();
+}
+
+void AttackNGram::SetPrior( const FAttackContext* table, int32 tableSize ) {
+	priorContexts = table;
+	priorCapacity = table ? tableSize : 0;
+
+	// every cached table was built with the old prior's counts
+	ClearAliasCache();
+}
+
+const FAttackContext* AttackNGram::FindContextInTable( const FAttackContext* table, int32 tableSize, uint64 key ) {
+	uint32 mask = ( uint32 )tableSize - 1;
+	uint32 slot = HashContextKey( key, mask );
+	// a table with no empty slot, such as a corrupt model file, is searched once through and no more
+	for ( int32 probe = 0; probe < tableSize; probe++, slot = ( slot + 1 ) & mask ) {
+		const FAttackContext& context = table[ slot ];
+		if ( context.key == key )
+			return &context;
+		if ( context.key == 0 )
+			return nullptr;	// reached an empty slot, so the key is not in the table
+	}
+	return nullptr;
+}
+
+FAttackContext* AttackNGram::FindOrAddContextInTable( FAttackContext* table, int32 tableSize, uint64 key, bool& bOutAdded ) {
+	uint32 mask = ( uint32 )tableSize - 1;
+	for ( uint32 slot = HashContextKey( key, mask ); ; slot = ( slot + 1 ) & mask ) {
+		FAttackContext& context = table[ slot ];
+		bOutAdded = context.key == 0;
+		if ( context.key == key )
+			return &context;
+		if ( bOutAdded ) {
+			// claim the empty slot for the new context
+			context.key = key;
+			return &context;
+		}
+	}
+}
+
+int32 AttackNGram::GetContextWeights( const FAttackContext* context, const FAttackContext* priorContext, float* outWeights, float& outTotalWeight ) const {
+	int32 distinct = 0;
+	outTotalWeight = 0;
+	for ( int32 i = 0; i < NumAttacks; i++ ) {
+		uint32 count = ( context ? context->counts[ i ] : 0 ) + ( priorContext ? priorContext->counts[ i ] : 0 );
+		outWeights[ i ] = ( float )count * historyWeightPowers[ context ? context->recentCounts[ i ] : 0 ];
+		outTotalWeight += outWeights[ i ];
+		if ( count != 0 )
+			distinct++;
+	}
+	return distinct;
+}
+
+const FAttackAliasTable& AttackNGram::GetAliasTable( uint64 key, const FAttackContext* context, const FAttackContext* priorContext ) const {
+	// the prior never changes, so the session context's total and version are enough to tell if the table is current
+	uint32 total = context ? context->total : 0;
+	uint8 version = context ? context->version : 0;
+	FAttackAliasTable& table = aliasCache[ HashContextKey( key, AliasCacheSize - 1 ) ];
+	if ( table.key == key && table.total == total && table.version == version )
+		return table;
+
+	table.key = key;
+	table.total = total;
+	table.version = version;
+
+	float weights[ NumAttacks ];
+	float totalWeight;
+	int32 distinct = GetContextWeights( context, priorContext, weights, totalWeight );
+	table.keepProbability = totalWeight > 0 ? totalWeight / ( totalWeight + distinct ) : 0;
+
+	// split the columns into those under and over the average weight
+	float scaled[ NumAttacks ];
+	int32 small[ NumAttacks ], large[ NumAttacks ];
+	int32 numSmall = 0, numLarge = 0;
+	for ( int32 i = 0; i < NumAttacks; i++ ) {
+		scaled[ i ] = totalWeight > 0 ? weights[ i ] * NumAttacks / totalWeight : 1;
+		if ( scaled[ i ] < 1 )
+			small[ numSmall++ ] = i;
+		else
+			large[ numLarge++ ] = i;
+	}
+
+	// fill each small column up to the average with part of a large column
+	while ( numSmall > 0 && numLarge > 0 ) {
+		int32 under = small[ --numSmall ];
+		int32 over = large[ numLarge - 1 ];
+		table.probability[ under ] = scaled[ under ];
+		table.alias[ under ] = ( uint8 )over;
+		scaled[ over ] -= 1 - scaled[ under ];
+		if ( scaled[ over ] < 1 ) {
+			numLarge--;
+			small[ numSmall++ ] = over;
+		}
+	}
+
+	// whatever is left is full up to rounding error
+	while ( numLarge > 0 ) {
+		int32 full = large[ --numLarge ];
+		table.probability[ full ] = 1;
+		table.alias[ full ] = ( uint8 )full;
+	}
+	while ( numSmall > 0 ) {
+		int32 full = small[ --numSmall ];
+		table.probability[ full ] = 1;
+		table.alias[ full ] = ( uint8 )full;
+	}
+
+	return table;
+}
+
+void AttackNGram::ClearAliasCache() {
+	for ( int32 i = 0; i < AliasCacheSize; i++ )
+		aliasCache[ i ].key = 0;
+}
+
+uint64 AttackNGram::MakeContextKey( int32 endIndex, int32 order ) const {
+	// order is stored above the attacks so contexts of different lengths never share a key, and no key is 0
+	uint64 key = ( uint64 )( order + 1 ) << 56;
+	for ( int32 i = 0; i < order; i++ )
+		key |= ( uint64 )GetHistoryAttack( endIndex - 1 - i ) << ( 5 * i );	// most recent attack in the lowest bits
+	return key;
+}
+
+FAttackContext* AttackNGram::FindOrAddContext( uint64 key ) {
+	// keep the table at most half full so probe chains stay short
+	if ( ( numContexts + 1 ) * 2 > contextCapacity )
+		GrowContexts();
+
+	bool bAdded;
+	FAttackContext* context = FindOrAddContextInTable( contexts, contextCapacity, key, bAdded );
+	if ( bAdded )
+		numContexts++;
+	return context;
+}
+
+void AttackNGram::GrowContexts() {
+	FAttackContext* oldContexts = contexts;
+	int32 oldCapacity = contextCapacity;
+
+	// set up an empty table twice the size
+	contextCapacity = oldCapacity * 2;
+	contexts = arena->AllocateTable( contextCapacity );
+
+	// reinsert every used slot
+	uint32 mask = ( uint32 )contextCapacity - 1;
+	for ( int32 i = 0; i < oldCapacity; i++ ) {
+		const FAttackContext& context = oldContexts[ i ];
+		if ( context.key == 0 )
+			continue;
+		uint32 slot = HashContextKey( context.key, mask );
+		while ( contexts[ slot ].key != 0 )
+			slot = ( slot + 1 ) & mask;
+		contexts[ slot ] = context;
+	}
+
+	// the old table can be reused by the arena
+	arena->FreeTable( oldContexts, oldCapacity );
+}
+
+void AttackNGram::RescaleContext( FAttackContext& context ) {
+	context.total = 0;
+	context.distinct = 0;
+	for ( int32 i = 0; i < NumAttacks; i++ ) {
+		context.counts[ i ] /= 2;
+		context.total += context.counts[ i ];
+		if ( context.counts[ i ] != 0 )
+			context.distinct++;
+	}
+}
@@ -0,0 +1,249 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "AttackContextArena.h"
+
+/**
+ * Statistics for one context (a sequence of previous attacks) of the N-gram. Stored in the open addressed table of AttackNGram.
+ */
+struct FAttackContext {
+	// packed context attacks and order. 0 marks an empty slot in the table
+	uint64 key;
+
+	// sum of all counts for this context
+	uint32 total;
+
+	// number of different attacks that have followed this context. Used as the escape count when backing off to shorter contexts
+	uint16 distinct;
+
+	// times each attack has followed this context over the whole session
+	uint16 counts[ 27 ];
+
+	// times each attack has followed this context inside the recent history window
+	uint8 recentCounts[ 27 ];
+
+	// incremented every time the counts change. Together with total it tells when a cached alias table is out of date
+	uint8 version;
+};
+
+/**
+ * Alias table for drawing an attack from one context's weights in constant time (Vose's alias method).
+ * Cached by AttackNGram and only rebuilt when the context's counts change.
+ */
+struct FAttackAliasTable {
+	// key of the context the table was built for. 0 marks an empty cache slot
+	uint64 key;
+
+	// total and version of the context when the table was built
+	uint32 total;
+	uint8 version;
+
+	// chance of drawing from this context's weights rather than escaping to the next shorter context
+	float keepProbability;
+
+	// chance of keeping each column's own attack rather than its alias
+	float probability[ 27 ];
+
+	// attack to use when a column's own attack is not kept
+	uint8 alias[ 27 ];
+};
+
+/**
+ * Variable order N-gram for predicting the player's next attack from the attacks that came before it.
+ * Every context from order 0 (no previous attacks) up to maxOrder previous attacks is counted.
+ * Predictions blend the counts of the longest context with the shorter ones, backing off to shorter contexts
+ * for attacks the longer ones have not seen yet (PPM style). Contexts are kept in an open addressed hash table that
+ * only grows with the contexts that have actually been seen, so longer orders do not cost 27^N memory.
+ * The table is allocated from an AttackContextArena so many models can share memory without per context heap allocations.
+ */
+class DRAGOON_API AttackNGram
+{
+public:
+	// number of unique attacks. IDs are the sum of an attack's direction and type, see FAttack
+	static const int32 NumAttacks = 27;
+
+	// longest context that fits in a context key. Each attack takes 5 bits of the key
+	static const int32 MaxSupportedOrder = 10;
+
+	// largest allowed history window. Recent counts are stored as uint8
+	static const int32 MaxHistorySize = 255;
+
+	// largest weight a recent sequence can get. Keeps the weights of a context, two full uint16 counts per attack, summing to a finite float
+	static constexpr float MaxHistoryWeightPower = 1e30f;
+
+private:
+	// how many previous attacks the longest context uses
+	int32 maxOrder;
+
+	// maximum amount of attacks to store in attack history
+	int32 historySize;
+
+	// how much recent history should account for
+	float historyWeight;
+
+	// arena the contexts table is allocated from
+	AttackContextArena* arena;
+
+	// open addressed hash table of every context seen. Allocated from arena
+	FAttackContext* contexts = nullptr;
+
+	// number of slots in the contexts table. Always a power of two
+	int32 contextCapacity = 0;
+
+	// number of slots in use in the contexts table
+	int32 numContexts = 0;
+
+	// read only table of contexts learned in earlier sessions. Its counts are added to this N-gram's counts. nullptr if there is no prior
+	const FAttackContext* priorContexts = nullptr;
+
+	// number of slots in the prior table. Always a power of two
+	int32 priorCapacity = 0;
+
+	// ring buffer holding the last historySize attacks. The oldest attack is at historyStart.
+	uint8 attackHistory[ MaxHistorySize ];
+
+	// index of the oldest attack in the history ring buffer
+	int32 historyStart = 0;
+
+	// number of attacks currently stored in the history ring buffer
+	int32 historyCount = 0;
+
+	// historyWeight raised to the power of the index. Lets predictions weight recent sequences without calling pow.
+	float historyWeightPowers[ MaxHistorySize + 1 ];
+
+	// number of slots in the alias table cache. Must be a power of two
+	static const int32 AliasCacheSize = 32;
+
+	// direct mapped cache of alias tables for recently predicted contexts. Filled in lazily while predicting
+	mutable FAttackAliasTable aliasCache[ AliasCacheSize ];
+
+public:
+	/**
+	 * Creates an empty N-gram.
+	 * @param contextArena	arena to allocate the contexts table from. Must outlive the N-gram
+	 * @param order			how many previous attacks the longest context uses. Clamped to MaxSupportedOrder
+	 * @param maxHistory	how many recent attacks are weighted more heavily than the rest of the session
+	 * @param weight		how much a sequence in the recent history is multiplied by for each time it appears. Weights that
+	 *						aren't positive are treated as 1, and the total weight of a sequence is capped at MaxHistoryWeightPower
+	 */
+	AttackNGram( AttackContextArena* contextArena, int32 order = 4, int32 maxHistory = 50, float weight = 2 );
+
+	// Destructor that returns the contexts table to the arena.
+	~AttackNGram();
+
+	// the contexts table belongs to a single N-gram so it cannot be copied
+	AttackNGram( const AttackNGram& ) = delete;
+	AttackNGram& operator=( const AttackNGram& ) = delete;
+
+	/**
+	 * Counts an attack as following every context of the current history, then adds it to the history.
+	 * @param attackID	the ID of the attack that was made
+	 */
+	void RecordAttack( int32 attackID );
+
+	/**
+	 * Fills outProbabilities with the chance of each attack being the next one made, given the current history.
+	 * @param outProbabilities	array of NumAttacks floats that sum to 1
+	 */
+	void GetPrediction( float* outProbabilities ) const;
+
+	/**
+	 * Chooses the next attack weighted by the probabilities from GetPrediction.
+	 * Starts at the longest context seen and either draws from its alias table or escapes to the next shorter context,
+	 * which gives the same probabilities as the blend in GetPrediction without visiting all 27 attacks.
+	 * @param randomValue	uniform random value in [0, 1) used to make the choice
+	 * @returns	the ID of the predicted attack
+	 */
+	int32 PredictAttack( float randomValue ) const;
+
+	/**
+	 * Removes all contexts and empties the history. The contexts table goes back to the arena.
+	 */
+	void Reset();
+
+	/**
+	 * Sets a table of contexts learned in earlier sessions to be added to this N-gram's own counts when predicting.
+	 * The table is only read, so it can be used straight out of a memory mapped model file.
+	 * @param table		open addressed table laid out the same as this N-gram's contexts table. nullptr to remove the prior
+	 * @param tableSize	number of slots in the table. Must be a power of two
+	 */
+	void SetPrior( const FAttackContext* table, int32 tableSize );
+
+	/**
+	 * Returns the context with key from an open addressed contexts table, or nullptr if it is not in the table.
+	 * Probes at most tableSize slots, so a full table is safe to search
+	 * @param table		the table to search
+	 * @param tableSize	number of slots in the table. Must be a power of two
+	 * @param key		the context's key
+	 */
+	static const FAttackContext* FindContextInTable( const FAttackContext* table, int32 tableSize, uint64 key );
+
+	/**
+	 * Returns the context with key from an open addressed contexts table, claiming an empty slot for it if it is not in the table.
+	 * The table must have at least one empty slot.
+	 * @param table		the table to search
+	 * @param tableSize	number of slots in the table. Must be a power of two
+	 * @param key		the context's key
+	 * @param bOutAdded	set to true if the context was added to the table
+	 */
+	static FAttackContext* FindOrAddContextInTable( FAttackContext* table, int32 tableSize, uint64 key, bool& bOutAdded );
+
+	/**
+	 * Halves every count of a context so counts can keep growing without overflowing
+	 */
+	static void RescaleContext( FAttackContext& context );
+
+	/** Returns maxOrder **/
+	FORCEINLINE int32 GetMaxOrder() const { return maxOrder; }
+	/** Returns numContexts **/
+	FORCEINLINE int32 GetNumContexts() const { return numContexts; }
+	/** Returns historyCount **/
+	FORCEINLINE int32 GetHistoryCount() const { return historyCount; }
+	/** Returns contexts **/
+	FORCEINLINE const FAttackContext* GetContexts() const { return contexts; }
+	/** Returns contextCapacity **/
+	FORCEINLINE int32 GetContextCapacity() const { return contextCapacity; }
+	/** Returns the attack stored at index of the history, where index 0 is the oldest attack **/
+	FORCEINLINE int32 GetHistoryAttack( int32 index ) const { return attackHistory[ ( historyStart + index ) % historySize ]; }
+
+private:
+	/**
+	 * Builds the key for the context made of the order attacks in the history before endIndex.
+	 * @param endIndex	history index of the attack following the context
+	 * @param order		how many attacks the context uses
+	 */
+	uint64 MakeContextKey( int32 endIndex, int32 order ) const;
+
+	/**
+	 * Weights each attack of a context by how often it appears in the recent history. Earlier sessions only add to the counts.
+	 * @param context			the context from this session. May be nullptr
+	 * @param priorContext		the same context from the prior. May be nullptr
+	 * @param outWeights		array of NumAttacks weights
+	 * @param outTotalWeight	sum of the weights
+	 * @returns	the number of attacks with a nonzero count, used as the escape count
+	 */
+	int32 GetContextWeights( const FAttackContext* context, const FAttackContext* priorContext, float* outWeights, float& outTotalWeight ) const;
+
+	/**
+	 * Returns the cached alias table for a context, rebuilding it if the context has changed since it was built.
+	 * @param key			the context's key
+	 * @param context		the context from this session. May be nullptr
+	 * @param priorContext	the same context from the prior. May be nullptr
+	 */
+	const FAttackAliasTable& GetAliasTable( uint64 key, const FAttackContext* context, const FAttackContext* priorContext ) const;
+
+	/**
+	 * Empties the alias table cache
+	 */
+	void ClearAliasCache();
+
+	/**
+	 * Returns the context with key, adding an empty one if it has not been seen. Pointer is only valid until the next add.
+	 */
+	FAttackContext* FindOrAddContext( uint64 key );
+
+	/**
+	 * Doubles the size of the contexts table and reinserts every context
+	 */
+	void GrowContexts();
+};
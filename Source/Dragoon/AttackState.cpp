@@ -30,34 +30,45 @@ void AttackState::EnterState( AEnemyAgent* agent ) {
 	controller->MoveToLocation( position );
 }
 
-void AttackState::StateTick( AEnemyAgent* agent, float deltaSeconds ) {
-	// make sure no other action is taking place for the agent
-	if ( agent->IsBusy() )
+void AttackState::StateTick( FAIStateContext& context ) {
+	// make sure no other action is taking place for the agent. An agent whose player has left waits for the state change
+	// the circles have asked for
+	const FAIAgentSnapshot& snapshot = context.snapshot;
+	if ( snapshot.bIsBusy || !snapshot.bHasPlayer )
 		return;
 
-
-	// setup the location the agent should move to, get new attack circle slot if current slot is not on the navmesh
-	ADragoonAIController* controller = ( ADragoonAIController* )agent->GetController();
-	// move to new destination if agent isn't in the proper place
-	if ( position != controller->GetAttackCircle()->GetLocationForAgent( agent ) ) {
-		position = controller->GetAttackCircle()->GetLocationForAgent( agent );
-		FNavLocation navLoc;
-		// make sure assigned position is on navmesh
-		if ( controller->navSystem->ProjectPointToNavigation( position, navLoc ) && navLoc.Location.Z <= agent->GetActorLocation().Z + 100 )
-			controller->MoveToLocation( position );
+	// move to new destination if agent's slot has changed or moved since the agent last set out for it
+	if ( snapshot.circleSlot != slot || snapshot.slotVersion != slotVersion ) {
+		slot = snapshot.circleSlot;
+		slotVersion = snapshot.slotVersion;
+		position = snapshot.slotLocation;
+		bIsSteering = false;
+		// the circle keeps track of which slots are on the navmesh
+		if ( snapshot.bIsSlotNavigable ) {
+			bIsSteering = context.MoveNearPlayer( position );
+			timeUntilSteer = steerInterval;
+		}
 		else
-			controller->GetAttackCircle()->GetNewSlotForAgent( agent );	// get new slot if current slot is not on the navmesh
+			context.commands.GetNewSlot( snapshot.controller );	// get new slot if current slot is not on the navmesh
+	}
+	// keep steering until close enough to the slot to find a path the rest of the way
+	else if ( bIsSteering ) {
+		timeUntilSteer -= snapshot.deltaSeconds;
+		if ( timeUntilSteer <= 0 ) {
+			bIsSteering = context.MoveNearPlayer( position );
+			timeUntilSteer = steerInterval;
+		}
 	}
 
 	// update timer
 	if ( elapsedTime <= timeBetweenAttacks ) {
-		elapsedTime += deltaSeconds;
+		elapsedTime += snapshot.deltaSeconds;
 		return;	// exit if timer gets updated, no other logic needed
 	}
 	
 	// perform attack and reset timer
-	controller->AttackPlayer();
-	timeBetweenAttacks = FMath::FRandRange( 2.0f, 3.5f );
+	context.commands.AttackPlayer( snapshot.controller );
+	timeBetweenAttacks = context.random.FRandRange( 2.0f, 3.5f );
 	elapsedTime = 0;
 }
 
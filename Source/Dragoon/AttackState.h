@@ -1,18 +1,29 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #pragma once
-#include "State.h"
+#include "AIStateContext.h"
 
 /**
  * 
  */
-class DRAGOON_API AttackState : State
+class DRAGOON_API AttackState
 {
 protected:
 	float timeBetweenAttacks = 0;
 	float elapsedTime = 0;
 
 	FVector position;
+
+	// slot and slot version the agent last moved towards. The agent only moves again once either changes
+	int32 slot = -1;
+	uint32 slotVersion = 0;
+
+	// true while the agent is steering along the player's flow field toward its slot rather than following a path to it
+	bool bIsSteering = false;
+
+	// seconds between steers, and seconds left until the next one
+	float steerInterval = 0.5f;
+	float timeUntilSteer = 0;
 public:
 	AttackState();
 	~AttackState();
@@ -21,18 +32,17 @@ public:
 	* Sets up the focus to be the player and puts the agent into the attack circle.
 	* @param agent	The agent who is currently using this state for behavior.
 	*/
-	virtual void EnterState( AEnemyAgent* agent );
+	void EnterState( AEnemyAgent* agent );
 
 	/**
 	* Checks if the agent can attack, and chooses an attack if possible
-	* @param agent	The agent who is currently using this state for behavior.
-	* @param deltaSeconds	The amount of time that has passed since the last tick of the game engine
+	* @param context	The snapshot of the agent to read, and the commands to record into.
 	*/
-	virtual void StateTick( AEnemyAgent* agent, float deltaSeconds );
+	void StateTick( FAIStateContext& context );
 
 	/**
 	* Clears the focus of the agent.
 	* @param agent	The agent who is currently using this state for behavior.
 	*/
-	virtual void ExitState( AEnemyAgent* agent );
+	void ExitState( AEnemyAgent* agent );
 };
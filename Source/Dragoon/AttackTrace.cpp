@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "AttackTrace.h"
+#include <chrono>
+#include <random>
+#include <string>
+
+#if PLATFORM_WINDOWS
+#include "AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "HideWindowsPlatformTypes.h"
+#endif
+
+// how long the writer thread sleeps between draining the queue
+static const int32 WriterIntervalMilliseconds = 10;
+
+#if PLATFORM_WINDOWS
+// converts a UTF-8 string to the wide string the Windows file functions take
+static std::wstring Utf8ToWide( const char* path ) {
+	int32 length = MultiByteToWideChar( CP_UTF8, 0, path, -1, nullptr, 0 );
+	std::wstring widePath( length > 0 ? length : 1, L'\0' );
+	if ( length > 0 )
+		MultiByteToWideChar( CP_UTF8, 0, path, -1, &widePath[ 0 ], length );
+	return widePath;
+}
+#endif
+
+// opens a file from a UTF-8 path
+static FILE* OpenTraceFile( const char* path, const char* mode ) {
+#if PLATFORM_WINDOWS
+	return _wfopen( Utf8ToWide( path ).c_str(), Utf8ToWide( mode ).c_str() );
+#else
+	return fopen( path, mode );
+#endif
+}
+
+AttackTraceWriter::AttackTraceWriter()
+	: queueHead( 0 ), queueTail( 0 ), numDropped( 0 ), bStopRequested( false ), bWriteFailed( false )
+{
+}
+
+AttackTraceWriter::~AttackTraceWriter()
+{
+	Close();
+}
+
+bool AttackTraceWriter::Open( const char* path ) {
+	Close();
+
+	file = OpenTraceFile( path, "wb" );
+	if ( !file )
+		return false;
+
+	FAttackTraceHeader header;
+	header.magic = Magic;
+	header.version = Version;
+	header.recordSize = sizeof( FAttackTraceRecord );
+	header.reserved = 0;
+	if ( fwrite( &header, sizeof( header ), 1, file ) != 1 ) {
+		fclose( file );
+		file = nullptr;
+		return false;
+	}
+
+	// start with an empty queue and a running writer
+	queueHead.store( 0 );
+	queueTail.store( 0 );
+	numDropped.store( 0 );
+	bStopRequested.store( false );
+	bWriteFailed.store( false );
+	writerThread = std::thread( &AttackTraceWriter::WriterLoop, this );
+	return true;
+}
+
+void AttackTraceWriter::Close() {
+	if ( !file )
+		return;
+
+	// let the writer finish what is queued, then close the file
+	bStopRequested.store( true, std::memory_order_release );
+	if ( writerThread.joinable() )
+		writerThread.join();
+	if ( fclose( file ) != 0 )
+		bWriteFailed.store( true, std::memory_order_relaxed );
+	file = nullptr;
+}
+
+bool AttackTraceWriter::Append( const FAttackTraceRecord& record ) {
+	if ( !file || bWriteFailed.load( std::memory_order_relaxed ) )
+		return false;
+
+	uint32 head = queueHead.load( std::memory_order_relaxed );
+	if ( head - queueTail.load( std::memory_order_acquire ) >= QueueSize ) {
+		// the writer has fallen behind. Drop the record rather than wait for it
+		numDropped.fetch_add( 1, std::memory_order_relaxed );
+		return false;
+	}
+
+	// fill in the slot before publishing it to the writer
+	queue[ head & ( QueueSize - 1 ) ] = record;
+	queueHead.store( head + 1, std::memory_order_release );
+	return true;
+}
+
+void AttackTraceWriter::WriterLoop() {
+	while ( !bStopRequested.load( std::memory_order_acquire ) ) {
+		DrainQueue();
+		std::this_thread::sleep_for( std::chrono::milliseconds( WriterIntervalMilliseconds ) );
+	}
+
+	// write anything queued before the stop was requested
+	DrainQueue();
+	fflush( file );
+}
+
+void AttackTraceWriter::DrainQueue() {
+	uint32 tail = queueTail.load( std::memory_order_relaxed );
+	uint32 head = queueHead.load( std::memory_order_acquire );
+	if ( tail == head )
+		return;
+
+	// write the queued records in at most two pieces, as they may wrap around the end of the ring. After a short write the
+	// file may end partway through a record, which the replayer ignores, but any record written after it would be misaligned
+	while ( tail != head && !bWriteFailed.load( std::memory_order_relaxed ) ) {
+		uint32 start = tail & ( QueueSize - 1 );
+		uint32 count = head - tail;
+		if ( start + count > QueueSize )
+			count = QueueSize - start;
+		if ( fwrite( &queue[ start ], sizeof( FAttackTraceRecord ), count, file ) != count )
+			bWriteFailed.store( true, std::memory_order_relaxed );
+		tail += count;
+	}
+	tail = head;	// anything left after a failed write is discarded
+
+	// hand the slots back to the game thread. Writes are buffered, so a failure may only show once they are flushed
+	queueTail.store( tail, std::memory_order_release );
+	if ( fflush( file ) != 0 )
+		bWriteFailed.store( true, std::memory_order_relaxed );
+}
+
+bool AttackTraceReplayer::Load( const char* path, std::vector<FAttackTraceRecord>& outRecords ) {
+	FILE* traceFile = OpenTraceFile( path, "rb" );
+	if ( !traceFile )
+		return false;
+
+	FAttackTraceHeader header;
+	bool bIsValid = fread( &header, sizeof( header ), 1, traceFile ) == 1
+		&& header.magic == AttackTraceWriter::Magic
+		&& header.version == AttackTraceWriter::Version
+		&& header.recordSize == sizeof( FAttackTraceRecord );
+
+	// read records until the end of the file. A record cut short by a crash is ignored
+	FAttackTraceRecord record;
+	while ( bIsValid && fread( &record, sizeof( record ), 1, traceFile ) == 1 ) {
+		if ( record.attackID < AttackNGram::NumAttacks )
+			outRecords.push_back( record );
+	}
+
+	fclose( traceFile );
+	return bIsValid;
+}
+
+FAttackReplayResults AttackTraceReplayer::Replay( const std::vector<FAttackTraceRecord>& records, AttackModelPool& pool, uint32 seed ) {
+	FAttackReplayResults results;
+	std::mt19937 engine( seed );
+	std::uniform_real_distribution<float> randomValue( 0.0f, 1.0f );
+
+	auto start = std::chrono::steady_clock::now();
+	for ( const FAttackTraceRecord& record : records ) {
+		// handles start at 0, but a null owner marks an unused model
+		FAttackModel& model = pool.GetModel( ( const void* )( ( UPTRINT )record.attackerHandle + 1 ) );
+
+		results.numAttacks++;
+		results.recordedHits += record.predictedAttack == record.attackID ? 1 : 0;
+		results.replayedHits += model.nextAttackPrediction == record.attackID ? 1 : 0;
+		results.replayedConfidence += model.predictionConfidence;
+
+		// same steps as RecordPlayerAttack
+		model.UpdateConfidence( record.attackID );
+		model.nGram.RecordAttack( record.attackID );
+		float value = randomValue( engine );
+		model.PredictNextAttack( value < 1.0f ? value : 0.0f );
+	}
+	results.replaySeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+	if ( !records.empty() )
+		results.traceSeconds = records.back().timeSeconds - records.front().timeSeconds;
+	return results;
+}
@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "AttackModelPool.h"
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+/**
+ * Header at the start of an attack trace file. Records follow it until the end of the file.
+ */
+struct FAttackTraceHeader {
+	// identifies the file as an attack trace. Also catches files written with a different byte order
+	uint32 magic;
+
+	// format version. Files with a different version are not read
+	uint32 version;
+
+	// size of each record in bytes
+	uint32 recordSize;
+
+	// keeps the records that follow 8 byte aligned
+	uint32 reserved;
+};
+
+/**
+ * One player attack as it was recorded by DragoonAIBlackboard::RecordPlayerAttack.
+ */
+struct FAttackTraceRecord {
+	// seconds since the trace was started
+	double timeSeconds;
+
+	// identifies the attacking character. Each attacker is replayed through their own model
+	uint32 attackerHandle;
+
+	// identifies the agent being attacked
+	uint32 targetHandle;
+
+	// confidence in the prediction at the time of the attack
+	float predictionConfidence;
+
+	// ID of the attack made, see FAttack
+	uint8 attackID;
+
+	// direction and type the attack ID was made from
+	uint8 direction;
+	uint8 type;
+
+	// the attack that had been predicted before this one was made
+	uint8 predictedAttack;
+};
+
+/**
+ * Results of replaying a trace through a set of prediction models.
+ */
+struct FAttackReplayResults {
+	// attacks replayed
+	int64 numAttacks = 0;
+
+	// attacks that matched the prediction recorded in the trace, made by the predictor that was live at the time
+	int64 recordedHits = 0;
+
+	// attacks that matched the prediction made by the predictor used for the replay
+	int64 replayedHits = 0;
+
+	// sum of the replay's confidence before each attack. Divided by numAttacks it can be compared with the replay's hit rate
+	double replayedConfidence = 0;
+
+	// seconds of play covered by the trace and seconds the replay took
+	double traceSeconds = 0;
+	double replaySeconds = 0;
+};
+
+/**
+ * Append only binary trace of player attacks.
+ * Records are pushed into a fixed size lock free queue and written to disk by a background thread, so recording
+ * never waits on file I/O. If the writer falls behind and the queue fills up, records are dropped and counted instead of blocking.
+ * If a write comes up short the trace stops there, so the file never holds misaligned records.
+ */
+class DRAGOON_API AttackTraceWriter
+{
+public:
+	// "DRGT" read as a little endian uint32
+	static const uint32 Magic = 0x54475244;
+
+	// current version of the trace format. Increment when FAttackTraceRecord changes
+	static const uint32 Version = 1;
+
+private:
+	// number of records the queue can hold. Must be a power of two
+	static const uint32 QueueSize = 4096;
+
+	// single producer single consumer ring of records waiting to be written
+	FAttackTraceRecord queue[ QueueSize ];
+
+	// total records pushed by the game thread. Only written by Append
+	std::atomic<uint32> queueHead;
+
+	// total records written by the background thread. Only written by the writer thread
+	std::atomic<uint32> queueTail;
+
+	// records that did not fit in the queue
+	std::atomic<uint32> numDropped;
+
+	// set to ask the writer thread to write what is left and stop
+	std::atomic<bool> bStopRequested;
+
+	// set by the writer thread when a write comes up short. Nothing more is queued or written to the file after it
+	std::atomic<bool> bWriteFailed;
+
+	// file the trace is written to. nullptr if no trace is open
+	FILE* file = nullptr;
+
+	// thread that drains the queue into the file
+	std::thread writerThread;
+
+public:
+	AttackTraceWriter();
+
+	// Destructor that finishes writing any open trace
+	~AttackTraceWriter();
+
+	// the writer thread refers to this instance so it cannot be copied
+	AttackTraceWriter( const AttackTraceWriter& ) = delete;
+	AttackTraceWriter& operator=( const AttackTraceWriter& ) = delete;
+
+	/**
+	 * Creates a new trace file and starts the writer thread. Closes any trace already open.
+	 * @param path	UTF-8 path of the file
+	 * @returns	true if the file was created
+	 */
+	bool Open( const char* path );
+
+	/**
+	 * Writes every queued record and closes the file. Waits for the writer thread to finish.
+	 */
+	void Close();
+
+	/**
+	 * Queues a record to be written. Never blocks. Must only be called from one thread at a time.
+	 * @param record	the attack to record
+	 * @returns	false if the queue was full and the record was dropped, or if writing the trace has failed
+	 */
+	bool Append( const FAttackTraceRecord& record );
+
+	/** Returns true if a trace is open **/
+	FORCEINLINE bool IsOpen() const { return file != nullptr; }
+	/** Returns numDropped **/
+	FORCEINLINE uint32 GetNumDropped() const { return numDropped.load( std::memory_order_relaxed ); }
+	/** Returns true if writing the trace has failed **/
+	FORCEINLINE bool HasWriteFailed() const { return bWriteFailed.load( std::memory_order_relaxed ); }
+
+private:
+	/**
+	 * Loop run by the writer thread. Drains the queue every few milliseconds until a stop is requested.
+	 */
+	void WriterLoop();
+
+	/**
+	 * Writes every record currently in the queue to the file. Discards them instead once a write has failed
+	 */
+	void DrainQueue();
+};
+
+/**
+ * Reads attack traces and replays them through prediction models faster than real time.
+ * Replays use their own seeded random numbers so the same trace, seed and predictor always give the same results,
+ * which lets predictor changes be compared against real player sessions.
+ */
+class DRAGOON_API AttackTraceReplayer
+{
+public:
+	/**
+	 * Reads every record of a trace file.
+	 * @param path			UTF-8 path of the file
+	 * @param outRecords	filled with the records in the order they were recorded
+	 * @returns	true if the file is a trace of the current version
+	 */
+	static bool Load( const char* path, std::vector<FAttackTraceRecord>& outRecords );
+
+	/**
+	 * Feeds records through a pool of models the same way DragoonAIBlackboard::RecordPlayerAttack does, as fast as possible.
+	 * Each attacker in the trace gets their own model from the pool.
+	 * @param records	the trace to replay
+	 * @param pool		models to replay the trace through. Usually a fresh pool so live models are not changed
+	 * @param seed		seed for the random numbers used to draw predictions
+	 * @returns	how the replayed predictions compare to the recorded ones
+	 */
+	static FAttackReplayResults Replay( const std::vector<FAttackTraceRecord>& records, AttackModelPool& pool, uint32 seed );
+};
@@ -5,4 +5,7 @@
 
 #include "EngineMinimal.h"
 
+// shown with "stat DragoonAI"
+DECLARE_STATS_GROUP( TEXT( "DragoonAI" ), STATGROUP_DragoonAI, STATCAT_Advanced );
+
 #endif
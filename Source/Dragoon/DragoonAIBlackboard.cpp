@@ -3,148 +3,246 @@
 #include "Dragoon.h"
 #include "DragoonAIController.h"
 #include "DragoonAIBlackboard.h"
+#include "Async/Async.h"
 
 DragoonAIBlackboard::DragoonAIBlackboard()
 {
-	// initialize arrays to be empty
-	agentsInCombat.Empty();
-	agentsNotInCombat.Empty();
-	for ( int i = 0; i < 27; i++ ) {
-		for ( int j = 0; j < 27; j++ ) {
-			for ( int k = 0; k < 27; k++ ) {
-				attackNGram[ i ][ j ][ k ] = 0;
-			}
-		}
-	}
 }
 
-DragoonAIBlackboard::DragoonAIBlackboard( AttackCircle* circle ) {
-	// initialize arrays to be empty
-	agentsInCombat.Empty();
-	agentsNotInCombat.Empty();
-
-	// setup the n gram prediction array to have one occurence of all possibilities
-	// This allows for better predictions later by having every potential outcome have at least a slender potential.
-	// By having very small chances for unseen attacks, it means it carries a very low rate of use versus a random 20% choice to pick a random attack
-	for ( int i = 0; i < 27; i++ ) {
-		for ( int j = 0; j < 27; j++ ) {
-			for ( int k = 0; k < 27; k++ ) {
-				attackNGram[ i ][ j ][ k ] = 1;
-			}
-		}
-	}
-
-	// set attack circle reference
-	attackCircle = circle;
+DragoonAIBlackboard::DragoonAIBlackboard( AttackCircleManager* circles ) {
+	// set attack circle manager reference
+	attackCircles = circles;
 }
 
 DragoonAIBlackboard::~DragoonAIBlackboard()
 {
+	// the prediction task uses the models, so it must finish first
+	WaitForPendingAttacks();
+
 	// remove pointer reference
-	attackCircle = nullptr;
+	attackCircles = nullptr;
 
-	// empty arrays of references
-	agentsInCombat.Empty();
-	agentsNotInCombat.Empty();
+	// remove every agent
+	agents.Reset();
+}
+
+void DragoonAIBlackboard::SetAttackCircles( AttackCircleManager* circles ) {
+	attackCircles = circles;
 }
 
 void DragoonAIBlackboard::RegisterAgent( AEnemyAgent* agent ) {
-	// check to make sure there aren't multiple references to the same agent in either array
-	if ( agentsNotInCombat.Contains( agent ) || agentsInCombat.Contains( agent ) )
+	// make sure the agent is not registered twice
+	if ( agents.Get( agent->GetBlackboardHandle() ) == agent )
 		return;
-	else
-		agentsNotInCombat.Add( agent );	// put agent in non-combat array
+
+	agent->SetBlackboardHandle( agents.Add( agent ) );	// new agents start out of combat
 }
 
 void DragoonAIBlackboard::RemoveAgent( AEnemyAgent* agent ) {
-	// check through arrays for agent and remove from containing array
-	if ( agentsInCombat.Find( agent ) )
-		agentsInCombat.Remove( agent );
-	else if ( agentsNotInCombat.Find( agent ) )
-		agentsNotInCombat.Remove( agent );
+	// the handle stops being valid once the agent is removed, so a removed agent cannot be removed twice
+	if ( agents.Get( agent->GetBlackboardHandle() ) == agent && agents.Remove( agent->GetBlackboardHandle() ) )
+		agent->SetBlackboardHandle( FAgentHandle() );
 	else
 		UE_LOG( LogTemp, Error, TEXT( "Agent %s requesting removal from AI Blackboard is not registered in the blackboard!" ), *agent->GetName() );	// print error to log if an unregistered agent makes the request
 }
 
 void DragoonAIBlackboard::HaveAgentJoinCombat( AEnemyAgent* agent ) {
 	// checks for agent to have valid state
-	if ( agent->GetIsDead() || agent->GetIsInCombat() || agentsInCombat.Contains( agent ) || !agentsNotInCombat.Contains( agent ) )
+	FAgentHandle handle = agent->GetBlackboardHandle();
+	if ( agent->GetIsDead() || agent->GetIsInCombat() || agents.Get( handle ) != agent || agents.IsInCombat( handle ) )
 		return;
 	else {
-		// change the agents reference to be in combat array
-		RemoveAgent( agent );
-		agentsInCombat.Add( agent );
+		// move the agent into the combat agents
+		agents.SetInCombat( handle, true );
 		agent->JoinCombat();	// call agents function to perform any agent specific behavior needed for joining combat
 	}
 }
 
 void DragoonAIBlackboard::HaveAgentFleeCombat( AEnemyAgent* agent ) {
 	// checks for agent to have valid state
-	if ( agent->GetIsDead() || !agent->GetIsInCombat() || !agentsInCombat.Contains( agent ) || agentsNotInCombat.Contains( agent ) )
+	FAgentHandle handle = agent->GetBlackboardHandle();
+	if ( agent->GetIsDead() || !agent->GetIsInCombat() || agents.Get( handle ) != agent || !agents.IsInCombat( handle ) )
 		return;
 	else {
-		// swap agents reference to be in non-combat array
-		RemoveAgent( agent );
-		RegisterAgent( agent );
+		// move the agent back to the non-combat agents
+		agents.SetInCombat( handle, false );
 		agent->LeaveCombat();	// call agents function to perform any agent specific behavior for leaving combat
 	}
 }
 
 void DragoonAIBlackboard::RecordPlayerAttack( FAttack atk ) {
 	// make sure an active agent is in combat
-	if ( agentsInCombat.Num() == 0 )
+	if ( agents.GetNumInCombat() == 0 )
 		return;
 
-	// check if predicted attack is attack that was made
-	if ( nextAttackPrediction == atk.id ) {
-		// increase the confidence in the prediction algorithm
-		predictionConfidence += 0.05f;
-		// check to make sure confidence is within clamped range
-		if ( predictionConfidence > 0.95f )
-			predictionConfidence = 0.95f;
-	}
-	else {
-		// decrease the confidence in the prediction algorithm
-		predictionConfidence -= 0.01f;
-		// check to make sure confidence is within clamped range
-		if ( predictionConfidence > 0.5f )
-			predictionConfidence = 0.5f;
-	}
+	// each attacker has their own model so their patterns do not pollute each other's predictions
+	int32 predictionIndex = GetAttackerPredictionIndex( atk.attacker );
+	FAttackerPrediction& attackerPrediction = attackerPredictions[ predictionIndex ];
 
-	// cycle attacks forward one slot. put most recent attack in atk3. The order is important as contents are being overwritten
-	atk1 = atk2;
-	atk2 = atk3;
-	atk3 = atk.id;
+	// read the latest prediction without waiting for the prediction task to catch up
+	int32 predictedAttack;
+	float predictionConfidence;
+	attackerPrediction.snapshot.Read( attackerPrediction.generation, predictedAttack, predictionConfidence );
+
+	// record the attack along with the prediction that was made for it
+	if ( attackTrace.IsValid() && attackTrace->IsOpen() ) {
+		FAttackTraceRecord record;
+		record.timeSeconds = FPlatformTime::Seconds() - attackTraceStartTime;
+		record.attackerHandle = atk.attacker ? atk.attacker->GetUniqueID() : 0;
+		record.targetHandle = atk.target ? atk.target->GetUniqueID() : 0;
+		record.predictionConfidence = predictionConfidence;
+		record.attackID = ( uint8 )atk.id;
+		record.direction = ( uint8 )atk.direction;
+		record.type = ( uint8 )atk.type;
+		record.predictedAttack = ( uint8 )predictedAttack;
+		attackTrace->Append( record );
+	}
 
 	// debug logging for testing
 	UE_LOG( LogTemp, Warning, TEXT( "Player is attacking %s" ), *atk.target->GetName() );
 
-	// update the n gram array to have another reference to attack sequence
-	attackNGram[ atk1 ][ atk2 ][ atk3 ]++;
-
-	// update history deque with new attack
-	if ( !bIsHistoryFull ) {
-		attackHistory.push_back( atk3 );
-		// check if history is now at our max size
-		if ( attackHistory.size() == maxHistorySize )
-			bIsHistoryFull = true;
-	}
-	else {
-		// remove oldest entry (will be the first entry as we add to the back), and add new attack to back of history
-		attackHistory.pop_front();
-		attackHistory.push_back( atk3 );
-	}
+	// count the attack for every context of the previous attacks and predict the next attack in the background
+	FPendingAttack pending;
+	pending.attacker = atk.attacker;
+	pending.attackID = atk.id;
+	pending.randomValue = FMath::FRand();
+	pending.snapshotIndex = predictionIndex;
+	pending.generation = attackerPrediction.generation;
+	QueuePendingAttack( pending );
 
 	// call agent behavior to respond to attack if it is in combat
-	if ( agentsInCombat.Contains( atk.target ) ) {
-		// make target react to incoming attack
+	if ( atk.target && agents.IsInCombat( atk.target->GetBlackboardHandle() ) ) {
+		// make target react to incoming attack, with the confidence the model will have once it sees whether the prediction was right
 		ADragoonAIController* AIController = (ADragoonAIController*)atk.target->GetController();
 		// testing access to ai controller. needs to be updated with actual logic for reacting to attacks
-		AIController->ReactToIncomingAttack( atk.id, predictionConfidence );
+		AIController->ReactToIncomingAttack( atk.id, FAttackModel::GetUpdatedConfidence( predictionConfidence, predictedAttack == atk.id ) );
+	}
+}
+
+void DragoonAIBlackboard::RemoveAttacker( ADragoonCharacter* attacker ) {
+	// stop publishing predictions for the attacker
+	for ( FAttackerPrediction& attackerPrediction : attackerPredictions ) {
+		if ( attackerPrediction.owner == attacker ) {
+			attackerPrediction.owner = nullptr;
+			attackerPrediction.generation++;
+		}
+	}
+
+	// free the attacker's model for anyone else who joins, after any of their attacks still pending
+	FPendingAttack pending;
+	pending.attacker = attacker;
+	pending.attackID = -1;
+	pending.randomValue = 0;
+	pending.snapshotIndex = 0;
+	pending.generation = 0;
+	QueuePendingAttack( pending );
+}
+
+void DragoonAIBlackboard::LoadAttackModels( const FString& path ) {
+	WaitForPendingAttacks();
+
+	// no file is expected the first time the game is played
+	if ( !learnedAttackModel.Open( TCHAR_TO_UTF8( *path ) ) ) {
+		UE_LOG( LogTemp, Log, TEXT( "No learned attack model loaded from %s" ), *path );
+		return;
 	}
 
-	// begin next attack prediction
-	PredictNextAttack();
+	// use the mapped table directly as the prior of every model
+	attackModels.SetPrior( learnedAttackModel.GetContexts(), learnedAttackModel.GetTableSize() );
+}
+
+void DragoonAIBlackboard::SaveAttackModels( const FString& path ) {
+	WaitForPendingAttacks();
+
+	// gather the N-gram of every model that has been used this session
+	const AttackNGram* models[ AttackModelPool::MaxModels ];
+	int32 numModels = 0;
+	for ( int32 i = 0; i < attackModels.GetNumModels(); i++ ) {
+		if ( attackModels.GetModelAt( i ).owner )
+			models[ numModels++ ] = &attackModels.GetModelAt( i ).nGram;
+	}
+
+	// the mapping is closed while saving, so no model can keep using it
+	attackModels.SetPrior( nullptr, 0 );
+	// models cleared during the session are saved from the pool's retired counts
+	if ( !AttackModelFile::Save( TCHAR_TO_UTF8( *path ), &learnedAttackModel, models, numModels,
+		attackModels.GetRetiredContexts(), attackModels.GetRetiredTableSize(), attackModels.GetNumRetired() ) )
+		UE_LOG( LogTemp, Error, TEXT( "Failed to save learned attack model to %s" ), *path );
+}
+
+void DragoonAIBlackboard::StartAttackTrace( const FString& path ) {
+	// the writer closes any trace already open
+	if ( !attackTrace.IsValid() )
+		attackTrace = MakeUnique<AttackTraceWriter>();
+	if ( !attackTrace->Open( TCHAR_TO_UTF8( *path ) ) ) {
+		UE_LOG( LogTemp, Error, TEXT( "Failed to start attack trace %s" ), *path );
+		attackTrace.Reset();
+		return;
+	}
+	attackTraceStartTime = FPlatformTime::Seconds();
+}
+
+void DragoonAIBlackboard::StopAttackTrace() {
+	if ( !attackTrace.IsValid() )
+		return;
+
+	// records are only dropped if the writer thread could not keep up
+	if ( attackTrace->IsOpen() && attackTrace->GetNumDropped() > 0 )
+		UE_LOG( LogTemp, Warning, TEXT( "Attack trace dropped %u attacks" ), attackTrace->GetNumDropped() );
+	attackTrace->Close();
+
+	// a failed write ends the trace early. Everything recorded before it can still be replayed
+	if ( attackTrace->HasWriteFailed() )
+		UE_LOG( LogTemp, Error, TEXT( "Attack trace stopped early because writing it failed" ) );
+	attackTrace.Reset();
+}
+
+FAttackReplayResults DragoonAIBlackboard::ReplayAttackTrace( const FString& path, uint32 seed ) {
+	std::vector<FAttackTraceRecord> records;
+	if ( !AttackTraceReplayer::Load( TCHAR_TO_UTF8( *path ), records ) ) {
+		UE_LOG( LogTemp, Error, TEXT( "Failed to load attack trace %s" ), *path );
+		return FAttackReplayResults();
+	}
+
+	// replay through models that start from the same learned patterns as the live ones
+	AttackModelPool replayModels;
+	if ( learnedAttackModel.IsOpen() )
+		replayModels.SetPrior( learnedAttackModel.GetContexts(), learnedAttackModel.GetTableSize() );
+	FAttackReplayResults results = AttackTraceReplayer::Replay( records, replayModels, seed );
+
+	int64 numAttacks = FMath::Max<int64>( results.numAttacks, 1 );
+	UE_LOG( LogTemp, Log, TEXT( "Replayed %lld attacks (%.1f s of play) in %.3f ms. Recorded hit rate %.3f, replayed hit rate %.3f, replayed confidence %.3f" ),
+		results.numAttacks, results.traceSeconds, results.replaySeconds * 1000.0,
+		( double )results.recordedHits / numAttacks, ( double )results.replayedHits / numAttacks, results.replayedConfidence / numAttacks );
+	return results;
+}
+
+void DragoonAIBlackboard::GetLatestPrediction( ADragoonCharacter* attacker, int32& outPrediction, float& outConfidence ) const {
+	for ( const FAttackerPrediction& attackerPrediction : attackerPredictions ) {
+		if ( attackerPrediction.owner == attacker ) {
+			attackerPrediction.snapshot.Read( attackerPrediction.generation, outPrediction, outConfidence );
+			return;
+		}
+	}
+
+	// the attacker has not attacked yet
+	outPrediction = FAttackModel::InitialPrediction;
+	outConfidence = FAttackModel::InitialConfidence;
+}
+
+void DragoonAIBlackboard::Tick() {
+	// an attack queued just as the last task found the queue empty waits for the next task, started here
+	if ( !pendingAttacks.IsEmpty() )
+		StartPredictionTask();
+}
+
+void DragoonAIBlackboard::WaitForPendingAttacks() {
+	while ( activePredictionTasks.GetValue() != 0 )
+		FPlatformProcess::Sleep( 0 );
+
+	// no task is running, so the game thread can add whatever the last task left behind itself
+	if ( !pendingAttacks.IsEmpty() )
+		ProcessPendingAttacks();
 }
 
 void DragoonAIBlackboard::AgentHasDied( AEnemyAgent* agent ) {
@@ -153,55 +251,69 @@ void DragoonAIBlackboard::AgentHasDied( AEnemyAgent* agent ) {
 	AIController->AgentHasDied();
 }
 
-void DragoonAIBlackboard::PredictNextAttack() {
-	// map to contain attack occurences from the entire playtime
-	TMap<int, int> cumulativeAttackOccurrences;
-	int totalAttackOccurrences = 0;
+int32 DragoonAIBlackboard::GetAttackerPredictionIndex( const void* attacker ) {
+	predictionUseCounter++;
 
-	// history must have 3 elements to make one prediction from it
-	if ( !bIsHistoryUsed ) {
-		// use history once 3 elements exist
-		if ( attackHistory.size() >= 3 )
-			bIsHistoryUsed = true;
-	}
-	else {
-		for ( int i = 0; i < 27; i++ ) {
-			// add each attack to the map
-			cumulativeAttackOccurrences.Add( i, attackNGram[ atk2 ][ atk3 ][ i ] );
-			totalAttackOccurrences += attackNGram[ atk2 ][ atk3 ][ i ];
+	// there are only a few attackers, so a linear search is cheapest
+	int32 leastRecentlyUsed = 0;
+	for ( int32 i = 0; i < AttackModelPool::MaxModels; i++ ) {
+		if ( attackerPredictions[ i ].owner == attacker ) {
+			attackerPredictions[ i ].lastUsed = predictionUseCounter;
+			return i;
 		}
+		if ( !attackerPredictions[ i ].owner || ( attackerPredictions[ leastRecentlyUsed ].owner && attackerPredictions[ i ].lastUsed < attackerPredictions[ leastRecentlyUsed ].lastUsed ) )
+			leastRecentlyUsed = i;
+	}
+
+	// hand the snapshot to the new attacker. Predictions still being published for the old one are ignored
+	FAttackerPrediction& attackerPrediction = attackerPredictions[ leastRecentlyUsed ];
+	attackerPrediction.owner = attacker;
+	attackerPrediction.generation++;
+	attackerPrediction.lastUsed = predictionUseCounter;
+	return leastRecentlyUsed;
+}
 
-		// check history for matching patterns
-		for ( int i = 0; i < attackHistory.size() - 2; i++ ) {
-			if ( attackHistory[ i ] == atk2 ) {
-				if ( attackHistory[ i + 1 ] == atk3 ) {
-					// subtract the amount currently in the history from total
-					totalAttackOccurrences -= attackHistory[ i + 2 ];
+void DragoonAIBlackboard::QueuePendingAttack( const FPendingAttack& pending ) {
+	pendingAttacks.Enqueue( pending );
+	StartPredictionTask();
+}
 
-					// multiply occurence by the weight for history
-					cumulativeAttackOccurrences[ attackHistory[ i + 2 ] ] *= historyWeight;
+void DragoonAIBlackboard::StartPredictionTask() {
+	// only the game thread starts tasks, so a task can only be running if the counter is still set
+	if ( activePredictionTasks.GetValue() != 0 )
+		return;
 
-					// add the amount back to total
-					totalAttackOccurrences += attackHistory[ i + 2 ];
-				}
-			}
-		}
+	activePredictionTasks.Set( 1 );
+	AsyncTask( ENamedThreads::AnyThread, [this]() { ProcessPendingAttacks(); } );
+}
 
-		// values for making a weighted prediction based on number of occurences
-		float predictionValue = FMath::FRand();
-		float currentRange = 0;
-
-		// loop to see which attack fits the prediction value
-		for ( int i = 0; i < attackHistory.size(); i++ ) {
-			// add the percentage chance of the attack to the already checked values
-			currentRange += ( float )attackHistory[ i ] / ( float )totalAttackOccurrences;
-			// check if prediction is met
-			if ( predictionValue <= currentRange ) {
-				// update the next predicted attack
-				nextAttackPrediction = i;
-				// exit function and loop
-				return;
-			}
+void DragoonAIBlackboard::ProcessPendingAttacks() {
+	FPendingAttack pending;
+	while ( pendingAttacks.Dequeue( pending ) ) {
+		if ( pending.attackID < 0 ) {
+			attackModels.RemoveModel( pending.attacker );
+			continue;
 		}
+
+		// same steps the game thread used to take for every attack
+		FAttackModel& model = attackModels.GetModel( pending.attacker );
+		model.UpdateConfidence( pending.attackID );
+		model.nGram.RecordAttack( pending.attackID );
+		PredictNextAttack( model, pending.randomValue );
+
+		// publish for the game thread. Sequence 0 is reserved for nothing published
+		FAttackerPrediction& attackerPrediction = attackerPredictions[ pending.snapshotIndex ];
+		if ( ++attackerPrediction.sequence == 0 )
+			attackerPrediction.sequence = 1;
+		attackerPrediction.snapshot.Publish( pending.generation, attackerPrediction.sequence, model.nextAttackPrediction, model.predictionConfidence );
 	}
+
+	// the last thing the task does. Once the counter is clear the blackboard may be destroyed, and attacks queued
+	// since the queue was found empty are left for the game thread to start another task for
+	activePredictionTasks.Set( 0 );
+}
+
+void DragoonAIBlackboard::PredictNextAttack( FAttackModel& model, float randomValue ) {
+	// make a weighted prediction from the blended probabilities of every context the history ends with
+	model.PredictNextAttack( randomValue );
 }
@@ -1,9 +1,50 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #pragma once
-#include "AttackCircle.h"
-#include <deque>	// do not remove this include. this class uses deque containers
+#include "AgentRegistry.h"
+#include "AttackCircleManager.h"
+#include "AttackModelFile.h"
+#include "AttackModelPool.h"
+#include "AttackTrace.h"
 #include "EnemyAgent.h"
+/**
+ * An attack waiting to be added to its attacker's model by the prediction task.
+ */
+struct FPendingAttack {
+	// the attacker whose model the attack belongs to
+	const void* attacker;
+
+	// ID of the attack made. -1 if the attacker's model should be removed instead
+	int32 attackID;
+
+	// random value for drawing the next prediction. Drawn on the game thread since FMath::FRand is not thread safe
+	float randomValue;
+
+	// snapshot the new prediction is published to and the generation it is published with
+	int32 snapshotIndex;
+	uint16 generation;
+};
+
+/**
+ * Where the latest prediction for one attacker is published.
+ */
+struct FAttackerPrediction {
+	// the attacker the snapshot is for. nullptr if unused. Game thread only
+	const void* owner = nullptr;
+
+	// incremented whenever the snapshot is given to another attacker so predictions for the old one are ignored. Game thread only
+	uint16 generation = 0;
+
+	// value of the use counter the last time the snapshot was used. Game thread only
+	uint32 lastUsed = 0;
+
+	// incremented for each prediction published. Prediction task only
+	uint8 sequence = 0;
+
+	// latest prediction and confidence. Written by the prediction task and read by the game thread
+	FAttackPredictionSnapshot snapshot;
+};
+
 /**
  * 
  */
@@ -12,82 +53,148 @@ class DRAGOON_API DragoonAIBlackboard
 public:
 
 private:
-	// a list of all registered agents who are not currently in the attack circle
-	TArray<AEnemyAgent*> agentsNotInCombat;
-
-	// a list of all registered agents who are in the attack circle
-	TArray<AEnemyAgent*> agentsInCombat;
+	// all registered agents, split into those in the attack circle and those who are not
+	AgentRegistry agents;
 
-	// pointer to an already established instance of an attack circle
-	AttackCircle* attackCircle;
+	// pointer to an already established manager of the attack circles
+	AttackCircleManager* attackCircles = nullptr;
 
-	// 3D array that stores ints derived from attacks. Used for predicting attacks from previous patterns.
-	int attackNGram[ 27 ][ 27 ][ 27 ];
+	// one N-gram prediction model per attacker. Used for predicting attacks from each attacker's previous patterns.
+	// Only touched by the prediction task while attacks are pending
+	AttackModelPool attackModels;
 
-	// deque to be used to store last x amount of attacks
-	std::deque<int> attackHistory;	// deque is used so it can be randomly accessed
+	// attacks recorded by the game thread that the prediction task has not added to the models yet
+	TQueue<FPendingAttack, EQueueMode::Spsc> pendingAttacks;
 
-	// variables to hold the previous three attacks made indices
-	int atk1 = 0, atk2 = 0, atk3 = 0;
+	// 1 while a prediction task is scheduled or running. Only set by the game thread, and cleared by the task as its
+	// last use of the blackboard, so only one task drains pendingAttacks at a time
+	FThreadSafeCounter activePredictionTasks;
 
-	// maximum amount of attacks to store in attack history
-	int maxHistorySize = 50;
+	// latest prediction for each attacker, published by the prediction task
+	FAttackerPrediction attackerPredictions[ AttackModelPool::MaxModels ];
 
-	// bool to state if attacks need to be removed from the deque when new ones are added
-	bool bIsHistoryFull = false;
+	// incremented every time an attacker's prediction is used. Used to find the least recently used snapshot
+	uint32 predictionUseCounter = 0;
 
-	// whether the information from history should be added to prediction loop (cannot be true until 3 attacks are in history)
-	bool bIsHistoryUsed = false;
+	// attack patterns learned in earlier sessions. Mapped read only and shared by every model as their prior
+	AttackModelFile learnedAttackModel;
 
-	// how much recent history should account for
-	int historyWeight = 2;
+	// records every player attack to disk while a trace is running. Only allocated then, since its ring buffer is large
+	TUniquePtr<AttackTraceWriter> attackTrace;
 
-	// the probability of an unknown or random attack
-	float predictionConfidence = 0.8f;
-
-	// what attack is predicted. Uses the ID system of attacks as its value
-	int nextAttackPrediction;
+	// platform time the running trace was started at
+	double attackTraceStartTime = 0;
 
 public:
 	// default c-tor. not to be used.
 	DragoonAIBlackboard();
 
-	// C-tor that will set the attack circle to be an already established instance and set agent arrays to be empty.
-	DragoonAIBlackboard( AttackCircle* circle );
+	// C-tor that will set the attack circle manager to be an already established instance and start with no agents.
+	DragoonAIBlackboard( AttackCircleManager* circles );
 
-	// Destructor that sets attack circle pointer to nullptr and empties arrays.
+	// Destructor that sets attack circle manager pointer to nullptr and removes every agent.
 	~DragoonAIBlackboard();
 
+	// the prediction models cannot be copied
+	DragoonAIBlackboard( const DragoonAIBlackboard& ) = delete;
+	DragoonAIBlackboard& operator=( const DragoonAIBlackboard& ) = delete;
+
+	/**
+	 * Sets the attack circle manager to be an already established instance.
+	 * @param circles	the manager of the attack circles agents in combat are placed in
+	 */
+	void SetAttackCircles( AttackCircleManager* circles );
+
 	/**
-	 * Adds an entry for an agent to the agents not in combat array.
+	 * Registers an agent as not in combat and stores its handle on the agent.
 	 * @param agent	pointer to an agent that is to be added to the blackboard
 	 */
 	void RegisterAgent( AEnemyAgent* agent );
 
 	/**
-	 * Removes a given agent from the blackboard's arrays. Will check for agent in both combat and non-combat arrays. Prints a log message if agent is not in either array.
+	 * Removes a given agent from the blackboard, whether it is in combat or not. Prints a log message if agent is not registered.
 	 * @param agent	pointer to agent that is to be removed from the blackboard
 	 */
 	void RemoveAgent( AEnemyAgent* agent );
 
 	/**
-	 * Removes agent from non-combat array and adds them to combat array. Calls the agent's JoinCombat function.
+	 * Moves agent from the non-combat agents to the combat agents. Calls the agent's JoinCombat function.
 	 * @param agent	pointer to agent to join combat
 	 */
 	void HaveAgentJoinCombat( AEnemyAgent* agent );
 
 	/**
-	 * Removes agent from combat array and adds them to non-combat array.
+	 * Moves agent from the combat agents to the non-combat agents.
 	 * @param agent	pointer to agent to leave combat
 	 */
 	void HaveAgentFleeCombat( AEnemyAgent* agent );
 
 	/**
-	 * Adds the player's most recent attack to the NGram 3D array. Also sends information to AIController of targeted agent to have them respond to attack.
-	 * @param atk	Struct containing the direction and type of attack being performed. Also sends target information of attack.
+	 * Queues the player's most recent attack to be added to the attacker's N-gram by a background task. Also sends information to
+	 * AIController of targeted agent to have them respond to attack, using the latest published prediction.
+	 * @param atk	Struct containing the direction and type of attack being performed. Also sends attacker and target information of attack.
 	 */
 	void RecordPlayerAttack( FAttack atk );
 
+	/**
+	 * Clears the prediction model of an attacker that has left the game
+	 * @param attacker	the attacker whose model should be removed
+	 */
+	void RemoveAttacker( ADragoonCharacter* attacker );
+
+	/**
+	 * Maps the attack patterns learned in earlier sessions and uses them as the prior of every prediction model.
+	 * @param path	the model file to load
+	 */
+	void LoadAttackModels( const FString& path );
+
+	/**
+	 * Merges this session's attack patterns into the learned patterns and writes them back to disk. Removes the prior from every model.
+	 * @param path	the model file to write
+	 */
+	void SaveAttackModels( const FString& path );
+
+	/**
+	 * Starts recording every player attack to a new trace file so the session can be replayed later.
+	 * @param path	the trace file to create
+	 */
+	void StartAttackTrace( const FString& path );
+
+	/**
+	 * Finishes writing the running trace, if any.
+	 */
+	void StopAttackTrace();
+
+	/**
+	 * Replays a recorded trace through a fresh set of prediction models as fast as possible and logs how well they predicted it.
+	 * The live models are not changed. The same trace and seed always give the same results.
+	 * @param path	the trace file to replay
+	 * @param seed	seed for the random numbers used to draw predictions
+	 * @returns	how the replayed predictions compare to the ones recorded in the trace
+	 */
+	FAttackReplayResults ReplayAttackTrace( const FString& path, uint32 seed );
+
+	/** Returns the registry of agents **/
+	FORCEINLINE const AgentRegistry& GetAgents() const { return agents; }
+
+	/**
+	 * Returns the latest prediction published for an attacker. Never blocks
+	 * @param attacker		the attacker whose next attack is predicted
+	 * @param outPrediction	the predicted attack ID
+	 * @param outConfidence	confidence in the prediction
+	 */
+	void GetLatestPrediction( ADragoonCharacter* attacker, int32& outPrediction, float& outConfidence ) const;
+
+	/**
+	 * Starts a prediction task for attacks left in the queue when the last task finished. Called once per frame
+	 */
+	void Tick();
+
+	/**
+	 * Blocks until the prediction task has finished, then adds any attacks still pending to the models
+	 */
+	void WaitForPendingAttacks();
+
 	/**
 	 * Let the AI Controller know that its agent has died
 	 * @param agent	the agent who has died
@@ -96,7 +203,30 @@ public:
 
 protected:
 	/**
-	* Algorithm to use attack occurences array and history deque to predict next attack
+	 * Returns the index of the prediction snapshot for an attacker, giving them the least recently used one if they do not have one
+	 */
+	int32 GetAttackerPredictionIndex( const void* attacker );
+
+	/**
+	 * Queues work for the prediction task and starts the task if it is not already running
+	 */
+	void QueuePendingAttack( const FPendingAttack& pending );
+
+	/**
+	 * Starts a task to drain the queue unless one is already running. Game thread only
+	 */
+	void StartPredictionTask();
+
+	/**
+	 * Run by the prediction task. Adds every pending attack to its attacker's model and publishes the new predictions
+	 */
+	void ProcessPendingAttacks();
+
+	/**
+	* Uses the N-gram's blended context probabilities to predict next attack
+	* @param model			the prediction model of the attacker whose next attack is predicted
+	* @param randomValue	uniform random value in [0, 1) used to make the prediction
 	*/
-	void PredictNextAttack();
+	void PredictNextAttack( FAttackModel& model, float randomValue );
+
 };
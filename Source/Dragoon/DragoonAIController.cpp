@@ -1,50 +1,30 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "Dragoon.h"
-#include "AttackState.h"
-#include "AlertState.h"
-#include "GuardState.h"
-#include "PatrolState.h"
 #include "DragoonAIController.h"
-#include "Perception/AIPerceptionComponent.h"
-#include "Perception/AISense_Sight.h"
-#include "Perception/AISenseConfig_Sight.h"
+#include "AI/Navigation/NavigationSystem.h"
+#include "AI/Navigation/RecastNavMesh.h"
 
 ADragoonAIController::ADragoonAIController() {
-	// setup AI Perception system
-	UAIPerceptionComponent* perception = CreateDefaultSubobject<UAIPerceptionComponent>( TEXT( "Perception Component" ) );
-	SetPerceptionComponent( *perception );
-	UAISenseConfig_Sight *sightConfig = CreateDefaultSubobject<UAISenseConfig_Sight>( TEXT( "Sight Config" ) );
-
-	// configure sight sense parameters
-	sightConfig->SightRadius = 1000;
-	sightConfig->LoseSightRadius = 1500;
-	sightConfig->PeripheralVisionAngleDegrees = 90;
-	sightConfig->DetectionByAffiliation.bDetectEnemies = true;
-	sightConfig->DetectionByAffiliation.bDetectFriendlies = true;
-	sightConfig->DetectionByAffiliation.bDetectNeutrals = true;
-
-	// register sight sense with perception system
-	GetAIPerceptionComponent()->ConfigureSense( *sightConfig );
-	GetAIPerceptionComponent()->SetDominantSense( sightConfig->GetSenseImplementation() );
-	GetAIPerceptionComponent()->OnPerceptionUpdated.AddDynamic( this, &ADragoonAIController::SenseUpdate );
+	// the game mode's state tick manager ticks every controller's state together
+	PrimaryActorTick.bCanEverTick = false;
+
+	// what the agent can see is decided by the game mode's sight service, for every agent together
 }
 
 ADragoonAIController::~ADragoonAIController() {
 	// remove all references
-	attackCircle = nullptr;
 	agent = nullptr;
 	game = nullptr;
-	delete currentState;
-	currentState = nullptr;
 }
 
 void ADragoonAIController::AgentHasDied() {
-	// remove agent from attack circle and blackboard
-	if ( attackCircle->GetEnemiesInCircle().Contains( agent ) )
-		attackCircle->RemoveAgentFromCircle( agent );
+	// remove agent from attack circle, or its line to join, and blackboard
+	game->attackCircles.RemoveAgent( agent );
 
 	game->blackboard.RemoveAgent( agent );
+	game->stateTicks.RemoveController( this );
+	game->sight.RemoveController( this );
 
 	// stop controlling the agent and destroy this controller
 	UnPossess();
@@ -52,19 +32,51 @@ void ADragoonAIController::AgentHasDied() {
 }
 
 void ADragoonAIController::AttackPlayer() {
+	// a busy agent would not start the attack, so it must not take score it would then hold until the lease expires
+	if ( agent->IsBusy() )
+		return;
+
 	// choose what type of attack to make
 	int attackChoice = agent->ChooseAttack();
-	// check with the attack circle to see if it can be performed 
-	if ( attackCircle->CanAgentPerformAttack( attackChoice ) )
+	// ask the attack circle for the score to perform it. If others are waiting, the circle starts the attack once it is this agent's turn
+	if ( GetAttackCircle()->RequestAttack( agent, attackChoice ) )
 		agent->PerformAttack( attackChoice );
 }
 
-void ADragoonAIController::SwapState( State* newState ) {
-	// if newstate exists...
-	if ( newState ) {
-		nextState = newState;	// update our state logic
-		bIsStateChangeReady = true;	// set boolean to alert logic to begin state change
+void ADragoonAIController::MoveAlongRoute( const UPatrolRoute* route, int32 leg, const FVector& destination ) {
+	// agents on the same route follow the same points rather than each finding their own
+	const TArray<FNavPathPoint>* points = game->patrolPaths.GetLegPoints( route, leg, navSystem );
+	ANavigationData* navData = navSystem ? navSystem->GetMainNavData( FNavigationSystem::DontCreate ) : nullptr;
+	if ( !points || !navData ) {
+		MoveToLocation( destination );
+		return;
 	}
+
+	// path following registers itself with the path it follows, so each agent gets a path of its own. It belongs to this
+	// controller, so it is found again for this agent if a navmesh change invalidates it
+	FNavPathSharedPtr path = MakeShareable( new FNavMeshPath() );
+	path->GetPathPoints() = *points;
+	path->SetNavigationDataUsed( navData );
+	path->SetQuerier( this );
+	path->MarkReady();
+	RequestMove( FAIMoveRequest( destination ), path );
+}
+
+void ADragoonAIController::AgentAdmittedToCircle() {
+	// the circle has already joined the agent, so the attack state only has to take its slot
+	SwapState( EAIStateType::AST_Attack );
+}
+
+void ADragoonAIController::SwapState( EAIStateType newState ) {
+	// the agent only goes to AlertState once, when a player is first seen, so guarding or patrolling must not replace it
+	bool bIsIdleState = newState == EAIStateType::AST_Guard || newState == EAIStateType::AST_Patrol;
+	if ( bIsStateChangeReady && nextStateType == EAIStateType::AST_Alert && bIsIdleState )
+		return;
+
+	// otherwise the state asked for last wins if more than one change is asked for in a frame
+	nextStateType = newState;	// update our state logic
+	bIsStateChangeReady = true;	// set boolean to alert logic to begin state change
+	game->stateTicks.QueueStateChange( this );
 }
 
 void ADragoonAIController::ReactToIncomingAttack( int attackID, float confidenceInAttack ) {
@@ -113,27 +125,6 @@ void ADragoonAIController::ReactToIncomingAttack( int attackID, float confidence
 	}
 }
 
-void ADragoonAIController::Tick( float DeltaSeconds ) {
-	// make sure agent is alive and valid
-	if ( agent->GetIsDead() )
-		return;
-
-	// do stuff every frame
-	Super::Tick( DeltaSeconds );
-	
-	/*********
-	!!!!!TESTING BELOW!!!!!
-	*********/
-
-	// if we have a state in the FSM, run its behavior
-	if ( currentState )
-		currentState->StateTick( agent, DeltaSeconds );
-
-	// check if the state is attempting to move to a new state
-	if ( bIsStateChangeReady && nextState )
-		TransitionBetweenStates();	// move to new state
-}
-
 void ADragoonAIController::BeginPlay() {
 	// call parent begin play
 	Super::BeginPlay();
@@ -141,42 +132,68 @@ void ADragoonAIController::BeginPlay() {
 	// setup pointer variables
 	game = ( ADragoonGameMode* )GetWorld()->GetAuthGameMode();
 	agent = ( AEnemyAgent* )GetCharacter();
-	attackCircle = &game->attackCircle;
 	navSystem = GetWorld()->GetNavigationSystem();
 
+	// seed from the agent's name so every play of a level draws the same numbers
+	randomStream.Initialize( ( int32 )GetTypeHash( agent->GetName() ) );
+
 	// register agent with blackboard
 	game->blackboard.RegisterAgent( agent );
 
 	// setup initial state for agent
-	if ( agent->waypoints.Num() == 0 )
-		currentState = ( State* )new GuardState();
+	if ( agent->GetPatrolWaypoints().Num() == 0 )
+		stateMachine.Reset( EAIStateType::AST_Guard );
 	else
-		currentState = ( State* )new PatrolState();
+		stateMachine.Reset( EAIStateType::AST_Patrol );
 
 	// make sure state is started correctly
-	currentState->EnterState( agent );
+	stateMachine.EnterState( agent );
+	game->stateTicks.AddController( this );
+	game->sight.AddController( this );
+}
+
+void ADragoonAIController::EndPlay( const EEndPlayReason::Type EndPlayReason ) {
+	if ( game ) {
+		game->stateTicks.RemoveController( this );
+		game->sight.RemoveController( this );
+	}
+
+	Super::EndPlay( EndPlayReason );
 }
 
 void ADragoonAIController::TransitionBetweenStates() {
+	if ( !bIsStateChangeReady )
+		return;
+
 	// begin transition
-	currentState->ExitState( agent );
+	stateMachine.ExitState( agent );
 
-	// update pointers to the new states
-	State* oldState = currentState;
-	currentState = nextState;
-	
-	// reset next state and remove the old state object
-	nextState = nullptr;
-	delete oldState;
+	// the new state starts fresh in the storage kept for its kind
+	stateMachine.Reset( nextStateType );
 
 	// start up the new state
-	if ( currentState )
-		currentState->EnterState( agent );
+	stateMachine.EnterState( agent );
 	
 	// state change has completed
 	bIsStateChangeReady = false;
 }
 
-void ADragoonAIController::SenseUpdate( TArray<AActor*> sensedActors ) {
-	perceivedActors = sensedActors;	// update owned array to mimic that of actors known by perception system
+void ADragoonAIController::SetPlayerSensed( AActor* player, bool bSensed ) {
+	if ( !agent || agent->GetIsDead() )
+		return;
+
+	if ( !bSensed ) {
+		sensedPlayers.Remove( player );
+		return;
+	}
+
+	bool bWasPlayerSensed = IsPlayerSensed();
+	sensedPlayers.AddUnique( player );
+
+	// if we have just seen the player, try to fight
+	if ( !bWasPlayerSensed ) {
+		EAIStateType stateType = stateMachine.type;
+		if ( stateType == EAIStateType::AST_Guard || stateType == EAIStateType::AST_Patrol )
+			SwapState( EAIStateType::AST_Alert );
+	}
 }
@@ -3,7 +3,7 @@
 #pragma once
 
 #include "EnemyAgent.h"
-#include "State.h"
+#include "AIStateMachine.h"
 #include "DragoonGameMode.h"
 #include "AttackCircle.h"
 #include "AIController.h"
@@ -22,24 +22,32 @@ public:
 
 	UNavigationSystem* navSystem;
 
-	TArray<AActor*> perceivedActors;
-
 private:
 	// reference to agent being controlled
 	AEnemyAgent* agent;
 
-	// reference to the main attack circle instance
-	AttackCircle* attackCircle;
-
 	// reference to the game mode
 	ADragoonGameMode* game;
 
-	// pointer to the current state of FSM for this controller/agent
-	State* currentState;
+	// every state of the FSM for this controller/agent, and which one is current
+	FAIStateMachine stateMachine;
+
+	// the kind of state to change to once the state tick manager applies state changes
+	EAIStateType nextStateType = EAIStateType::AST_Guard;
+
+	bool bIsStateChangeReady = false;
 
-	State* nextState;
+	// players the agent currently sees. Only changes when the sight service says the agent gains or loses a player
+	TArray<AActor*> sensedPlayers;
 
-	bool bIsStateChangeReady;
+	// index of the agent in the sight service. -1 if the agent is not being checked
+	int32 sightIndex = -1;
+
+	// random numbers for the agent's states. Each agent has its own so states can tick on any thread and still draw the same numbers
+	FRandomStream randomStream;
+
+	// index of the controller in the state tick manager's batch for its current state. -1 if the controller is not being ticked
+	int32 stateBatchIndex = -1;
 	
 public:
 	// default c-tor
@@ -59,15 +67,62 @@ public:
 	void AttackPlayer();
 
 	/**
-	 * Changes state from the currentState to the supplied newState
-	 * @param newState	pointer to the new state to be entered by the controller
+	 * Moves the agent along a leg of a patrol route, following a path of its own built from the points the game mode has cached for the leg.
+	 * Pathfinds to the destination as usual if the leg has no path.
+	 * @param route			the route being patrolled
+	 * @param leg			index of the waypoint the leg starts at
+	 * @param destination	the waypoint the leg ends at
+	 */
+	void MoveAlongRoute( const UPatrolRoute* route, int32 leg, const FVector& destination );
+
+	/**
+	 * Keeps track of which players are seen when the sight service says the agent gains or loses one.
+	 * Sends an agent that is guarding or patrolling to AlertState as soon as a player is first seen.
+	 * @param player	The player gained or lost
+	 * @param bSensed	Whether the player was gained or lost
+	 */
+	void SetPlayerSensed( AActor* player, bool bSensed );
+
+	/**
+	 * Called by the attack circle once the agent has been let in. Moves the agent from waiting to attacking
+	 */
+	void AgentAdmittedToCircle();
+
+	/**
+	 * Changes state from the current state to a fresh state of the supplied kind. A pending change to AlertState is never
+	 * replaced by a change to GuardState or PatrolState
+	 * @param newState	the kind of state to be entered by the controller
 	 */
-	void SwapState( State* newState );
+	void SwapState( EAIStateType newState );
 
-	/** return attack cicrle pointer **/
-	FORCEINLINE AttackCircle* GetAttackCircle() const { return attackCircle; }
+	/** return the attack circle the agent has been routed to **/
+	FORCEINLINE AttackCircle* GetAttackCircle() const { return game->attackCircles.GetCircleForAgent( agent ); }
 	/** return game mode pointer **/
 	FORCEINLINE ADragoonGameMode* GetGameMode() const { return game; }
+	/** return agent pointer **/
+	FORCEINLINE AEnemyAgent* GetAgent() const { return agent; }
+	/** return the state machine holding the current state **/
+	FORCEINLINE FAIStateMachine& GetStateMachine() { return stateMachine; }
+	/** return the kind of the current state **/
+	FORCEINLINE EAIStateType GetCurrentStateType() const { return stateMachine.type; }
+	/** return true if the agent's perception senses any player **/
+	FORCEINLINE bool IsPlayerSensed() const { return sensedPlayers.Num() > 0; }
+	/** return randomStream **/
+	FORCEINLINE FRandomStream& GetRandomStream() { return randomStream; }
+	/** return sightIndex **/
+	FORCEINLINE int32 GetSightIndex() const { return sightIndex; }
+	/** set sightIndex **/
+	FORCEINLINE void SetSightIndex( int32 index ) { sightIndex = index; }
+	/** return stateBatchIndex **/
+	FORCEINLINE int32 GetStateBatchIndex() const { return stateBatchIndex; }
+	/** set stateBatchIndex **/
+	FORCEINLINE void SetStateBatchIndex( int32 index ) { stateBatchIndex = index; }
+
+	/**
+	* Exit the current state and enter the new state, reusing the controller's storage for it. Called by the state tick manager
+	* once every agent has ticked, so states never change partway through a frame.
+	*/
+	void TransitionBetweenStates();
 
 	/**
 	 * Determine if predicted attack is trusted and choose proper reaction to attack
@@ -78,24 +133,13 @@ public:
 
 protected:
 	/**
-	 * Updates enemy logic every frame. Used for moving AI.
-	 */
-	virtual void Tick( float DeltaSeconds ) override;
-
-	/**
-	 * Event runs once and sets up variables for controller. Registers the controlled agent with the blackboard.
+	 * Event runs once and sets up variables for controller. Registers the controlled agent with the blackboard and
+	 * the controller with the state tick manager, which runs the controller's state every frame, and the sight service.
 	 */
 	virtual void BeginPlay() override;
 
 	/**
-	* Exit the current state and enter the new state. Deletes the old state pointer at the end.
-	*/
-	void TransitionBetweenStates();
-
-	/**
-	* Updates the array of known actors when the AI perception is updated
-	* @param perceivedActors	The actor array supplied by the perception system
-	*/
-	UFUNCTION()
-	void SenseUpdate( TArray<AActor*> perceivedActors );
+	 * Stops the state tick manager from ticking the controller and the sight service from checking it
+	 */
+	virtual void EndPlay( const EEndPlayReason::Type EndPlayReason ) override;
 };
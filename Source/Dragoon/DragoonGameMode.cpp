@@ -3,6 +3,7 @@
 #include "Dragoon.h"
 #include "DragoonGameMode.h"
 #include "DragoonCharacter.h"
+#include "AI/Navigation/NavigationSystem.h"
 
 ADragoonGameMode::ADragoonGameMode()
 {
@@ -14,6 +15,81 @@ ADragoonGameMode::ADragoonGameMode()
 	}
 
 	// create objects for use by AI systems
-	attackCircle = AttackCircle();
-	blackboard = DragoonAIBlackboard( &attackCircle );	// uses the attack circle made on previous line
+	blackboard.SetAttackCircles( &attackCircles );	// circles are added as players begin play
+	stateTicks.SetAttackCircles( &attackCircles );	// agents tick faster near players
+	sight.SetAttackCircles( &attackCircles );	// agents look for the players of the circles
+	flowFields.SetAttackCircles( &attackCircles );	// one field leads to each circle's player
+	stateTicks.SetFlowFields( &flowFields );	// agents in combat steer along the fields
+
+	bRecordAttackTraces = false;
+
+	// tick to update the attack circles and AI states every frame
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void ADragoonGameMode::BeginPlay() {
+	Super::BeginPlay();
+
+	// start with the patterns learned in earlier levels and sessions
+	blackboard.LoadAttackModels( GetAttackModelPath() );
+
+	// wander points, patrol paths and flow fields are only good for the navmesh they were found on
+	UNavigationSystem* navSystem = GetWorld()->GetNavigationSystem();
+	if ( navSystem )
+		navSystem->OnNavigationGenerationFinishedDelegate.AddDynamic( this, &ADragoonGameMode::OnNavigationGenerated );
+
+	// each session gets its own trace, named after when it started
+	if ( bRecordAttackTraces ) {
+		IFileManager::Get().MakeDirectory( *GetAttackTraceDir(), true );
+		blackboard.StartAttackTrace( GetAttackTraceDir() / FString::Printf( TEXT( "Trace-%s.bin" ), *FDateTime::Now().ToString() ) );
+	}
+}
+
+void ADragoonGameMode::EndPlay( const EEndPlayReason::Type EndPlayReason ) {
+	blackboard.StopAttackTrace();
+
+	// write back what was learned before the game mode is destroyed by a level change or quitting
+	blackboard.SaveAttackModels( GetAttackModelPath() );
+
+	Super::EndPlay( EndPlayReason );
+}
+
+void ADragoonGameMode::Tick( float DeltaSeconds ) {
+	Super::Tick( DeltaSeconds );
+
+	// pick up attacks the prediction task missed as it finished
+	blackboard.Tick();
+
+	// move the circles with their players and assign waiting agents to slots
+	attackCircles.Tick( DeltaSeconds );
+
+	// sample a few more wander points before guards draw from them
+	wanderPoints.Tick( GetWorld()->GetNavigationSystem() );
+
+	// follow players that have moved into another cell before agents steer toward them
+	flowFields.Tick( GetWorld()->GetNavigationSystem() );
+
+	// agents that spot a player change state along with this frame's state changes
+	sight.Tick( DeltaSeconds );
+
+	// run every agent's state against this frame's slot locations
+	stateTicks.Tick( DeltaSeconds );
+}
+
+FString ADragoonGameMode::GetAttackModelPath() const {
+	return FPaths::ConvertRelativePathToFull( FPaths::GameSavedDir() / TEXT( "AttackModel.bin" ) );
+}
+
+FString ADragoonGameMode::GetAttackTraceDir() const {
+	return FPaths::ConvertRelativePathToFull( FPaths::GameSavedDir() / TEXT( "AttackTraces" ) );
+}
+
+void ADragoonGameMode::OnNavigationGenerated( ANavigationData* navData ) {
+	wanderPoints.RebuildAll();
+	patrolPaths.Invalidate();
+	flowFields.Invalidate();
+}
+
+void ADragoonGameMode::ReplayAttackTrace( const FString& traceName, int32 seed ) {
+	blackboard.ReplayAttackTrace( GetAttackTraceDir() / traceName, ( uint32 )seed );
 }
@@ -1,22 +1,89 @@
 // Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
 #pragma once
-#include "AttackCircle.h"
+#include "AttackCircleManager.h"
+#include "AIStateTickManager.h"
+#include "SquadSightService.h"
+#include "WanderPointPools.h"
+#include "PatrolPathCache.h"
+#include "PlayerFlowFields.h"
 #include "DragoonAIBlackboard.h"
 #include "GameFramework/GameModeBase.h"
 #include "DragoonGameMode.generated.h"
 
+class ANavigationData;
+
 UCLASS(minimalapi)
 class ADragoonGameMode : public AGameModeBase
 {
 	GENERATED_BODY()
 
 public:
-	// instance of attack circle
-	AttackCircle attackCircle;
+	// one attack circle per player
+	AttackCircleManager attackCircles;
 
 	// instance of blackboard
 	DragoonAIBlackboard blackboard;
 
+	// ticks the state of every AI controller
+	AIStateTickManager stateTicks;
+
+	// decides which agents can see which players
+	SquadSightService sight;
+
+	// points guards wander between, one pool per guard post
+	WanderPointPools wanderPoints;
+
+	// paths between the waypoints of every patrol route in use
+	PatrolPathCache patrolPaths;
+
+	// flow fields leading to each player, steered along by agents in combat
+	PlayerFlowFields flowFields;
+
+	// record every player attack to Saved/AttackTraces so sessions can be replayed against predictor changes
+	UPROPERTY( EditDefaultsOnly, Category = "AI" )
+	bool bRecordAttackTraces;
+
 public:
 	ADragoonGameMode();
+
+	/**
+	 * Loads the attack patterns learned in earlier sessions into the blackboard and listens for the navmesh being regenerated
+	 */
+	virtual void BeginPlay() override;
+
+	/**
+	 * Saves this session's attack patterns so the next level or session starts with them
+	 */
+	virtual void EndPlay( const EEndPlayReason::Type EndPlayReason ) override;
+
+	/**
+	 * Updates the attack circles and flow fields, then what agents can see, then the state of every AI controller, once per frame
+	 */
+	virtual void Tick( float DeltaSeconds ) override;
+
+	/**
+	 * Console command that replays a recorded attack trace through fresh prediction models and logs the results
+	 * @param traceName	file name of the trace in Saved/AttackTraces
+	 * @param seed		seed for the random numbers used to draw predictions
+	 */
+	UFUNCTION( Exec )
+	void ReplayAttackTrace( const FString& traceName, int32 seed = 0 );
+
+	/**
+	 * Rebuilds every guard post's wander points and flow field and forgets every patrol path when the navmesh has been regenerated
+	 * @param navData	the navigation data that was regenerated
+	 */
+	UFUNCTION()
+	void OnNavigationGenerated( ANavigationData* navData );
+
+protected:
+	/**
+	 * Returns the full path of the file learned attack patterns are kept in
+	 */
+	FString GetAttackModelPath() const;
+
+	/**
+	 * Returns the full path of the directory attack traces are recorded in
+	 */
+	FString GetAttackTraceDir() const;
 };
@@ -107,15 +107,10 @@ void AEnemyAgent::DodgeAttack( EAttackDirection dir ) {
 void AEnemyAgent::FinishedAttacking() {
 	ADragoonGameMode* game = ( ADragoonGameMode* )GetWorld()->GetAuthGameMode();
 
-	// remove the attack score for the relevant attack from the attack circle
-	if ( bIsAttacking ) {
-		if ( bIsStrongAttack )
-			game->attackCircle.AgentAttackFinished( strongAttackScore );
-		else if ( bIsFeintAttack )
-			game->attackCircle.AgentAttackFinished( feintAttackScore );
-		else
-			game->attackCircle.AgentAttackFinished( quickAttackScore );
-	}
+	// return the attack score leased for the attack to the attack circle
+	AttackCircle* attackCircle = game->attackCircles.GetCircleForAgent( this );
+	if ( bIsAttacking && attackCircle )
+		attackCircle->AgentAttackFinished( this );
 
 	Super::FinishedAttacking();
 }
@@ -133,6 +128,17 @@ void AEnemyAgent::BeginPlay() {
 		guardPost = GetActorLocation();
 }
 
+void AEnemyAgent::EndPlay( const EEndPlayReason::Type EndPlayReason ) {
+	// dead agents have already been removed by their controller
+	ADragoonGameMode* game = ( ADragoonGameMode* )GetWorld()->GetAuthGameMode();
+	if ( game && game->blackboard.GetAgents().IsValid( blackboardHandle ) ) {
+		game->attackCircles.RemoveAgent( this );
+		game->blackboard.RemoveAgent( this );
+	}
+
+	Super::EndPlay( EndPlayReason );
+}
+
 void AEnemyAgent::Tick( float deltaSeconds ) {
 	Super::Tick( deltaSeconds );	// call parent function to ensure continuity
 
@@ -2,7 +2,9 @@
 
 #pragma once
 
+#include "AgentRegistry.h"
 #include "DragoonCharacter.h"
+#include "PatrolRoute.h"
 #include "EnemyAgent.generated.h"
 
 /**
@@ -18,6 +20,10 @@ public:
 	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = PatrolState )
 	TArray<FVector> waypoints;
 
+	// shared route to patrol instead of waypoints. Agents on the same route share the paths between its waypoints
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = PatrolState )
+	UPatrolRoute* patrolRoute = nullptr;
+
 	// position which a guard should protect
 	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = GuardState )
 	FVector guardPost = FVector::ZeroVector;
@@ -26,6 +32,9 @@ public:
 	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = PatrolState )
 	bool bIsPatrolContinuous = true;
 
+	/** Returns the waypoints of the patrol route, or the agent's own waypoints if it has no route **/
+	FORCEINLINE const TArray<FVector>& GetPatrolWaypoints() const { return patrolRoute ? patrolRoute->waypoints : waypoints; }
+
 	// particle system to spawn when the agent dies
 	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = Particles )
 	UParticleSystem* emitter;
@@ -44,6 +53,15 @@ private:
 	int feintAttackScore;
 	// Whether agent is in combat/attack circle
 	bool bIsInCombat = false;
+
+	// handle of the agent in the blackboard's registry. Not set until the agent registers
+	FAgentHandle blackboardHandle;
+
+	// index of the attack circle slot the agent occupies. -1 if the agent is not in the circle
+	int32 circleSlot = -1;
+
+	// index of the attack circle the agent has been routed to by the AttackCircleManager. -1 if the agent has not been routed
+	int32 attackCircleIndex = -1;
 	
 public:
 	// default c-tor needed for all UObject classes
@@ -62,6 +80,33 @@ public:
 	UFUNCTION( BlueprintCallable, Category = EnemyAgent )
 	FORCEINLINE bool GetIsInCombat() const { return bIsInCombat; }
 
+	/** Returns blackboardHandle **/
+	FORCEINLINE FAgentHandle GetBlackboardHandle() const { return blackboardHandle; }
+
+	/**
+	 * Sets the handle the blackboard registered the agent with
+	 * @param handle	the agent's handle in the blackboard's registry
+	 */
+	FORCEINLINE void SetBlackboardHandle( FAgentHandle handle ) { blackboardHandle = handle; }
+
+	/** Returns circleSlot **/
+	FORCEINLINE int32 GetCircleSlot() const { return circleSlot; }
+
+	/**
+	 * Sets the index of the attack circle slot the agent occupies. Only to be called by AttackCircle
+	 * @param slot	index of the slot, or -1 if the agent left the circle
+	 */
+	FORCEINLINE void SetCircleSlot( int32 slot ) { circleSlot = slot; }
+
+	/** Returns attackCircleIndex **/
+	FORCEINLINE int32 GetAttackCircleIndex() const { return attackCircleIndex; }
+
+	/**
+	 * Sets the index of the attack circle the agent has been routed to. Only to be called by AttackCircleManager
+	 * @param index	index of the circle, or -1 if the agent has no circle
+	 */
+	FORCEINLINE void SetAttackCircleIndex( int32 index ) { attackCircleIndex = index; }
+
 	/**
 	 * Wrapper function for equipping/unequipping sword
 	 */
@@ -119,6 +164,11 @@ protected:
 	*/
 	virtual void BeginPlay() override;
 
+	/**
+	 * Removes the agent from the blackboard if it is destroyed without dying, so no handle to it outlives it
+	 */
+	virtual void EndPlay( const EEndPlayReason::Type EndPlayReason ) override;
+
 	virtual void BasicAttack() override;
 
 	virtual void Tick( float deltaSeconds ) override;
@@ -150,12 +200,16 @@ struct FAttack {
 	UPROPERTY()
 	AEnemyAgent* target;	// enemy that is being attacked
 
+	UPROPERTY()
+	ADragoonCharacter* attacker;	// character that is making the attack
+
 	// default c-tor. needed for USTRUCT
 	FAttack() {
 		direction = EAttackDirection::AD_DownwardRightSlash;
 		type = EAttackType::AT_Quick;
 		id = NULL;
 		target = nullptr;
+		attacker = nullptr;
 	}
 
 	/**
@@ -163,11 +217,13 @@ struct FAttack {
 	 * @param dir		the direction of the attack being performed
 	 * @param atkType	the type of attack being performed (strong, quick, feint)
 	 * @param enemy		the target of the attack being performed
+	 * @param source	the character performing the attack
 	 */
-	FAttack( EAttackDirection dir, EAttackType atkType, AEnemyAgent* enemy ) {
+	FAttack( EAttackDirection dir, EAttackType atkType, AEnemyAgent* enemy, ADragoonCharacter* source ) {
 		direction = dir;
 		type = atkType;
 		id = ( uint8 )direction + ( uint8 )type;
 		target = enemy;
+		attacker = source;
 	}
 };
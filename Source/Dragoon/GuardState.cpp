@@ -2,9 +2,7 @@
 
 #include "Dragoon.h"
 #include "DragoonAIController.h"
-#include "PatrolState.h"
 #include "GuardState.h"
-#include "AlertState.h"
 
 GuardState::GuardState()
 {
@@ -19,46 +17,34 @@ void GuardState::EnterState( AEnemyAgent* agent ) {
 	ADragoonAIController* controller = ( ADragoonAIController* )agent->GetController();
 	controller->targetLoc = agent->GetActorLocation();
 	timeToWait = FMath::FRandRange( minWaitTime, maxWaitTime );
+	wanderPool = controller->GetGameMode()->wanderPoints.GetPool( agent->guardPost, wanderRange );
 
 	// set walk speed to look like normal marching
 	agent->GetCharacterMovement()->MaxWalkSpeed = 300;
 }
 
-void GuardState::StateTick( AEnemyAgent* agent, float DeltaSeconds ) {
-	ADragoonAIController* controller = ( ADragoonAIController* )agent->GetController();
+void GuardState::StateTick( FAIStateContext& context ) {
+	const FAIAgentSnapshot& snapshot = context.snapshot;
 
 	// is agent at the target destination?
-	if ( FVector::PointsAreNear( agent->GetActorLocation(), controller->targetLoc, 100 ) ) {
+	if ( FVector::PointsAreNear( snapshot.location, snapshot.targetLocation, 100 ) ) {
 		// see if we have been here long enough
 		if ( timeToWait > 0 )
-			timeToWait -= DeltaSeconds;	// update the wait timer
+			timeToWait -= snapshot.deltaSeconds;	// update the wait timer
 		else {
-			// get a new destination
-			FNavLocation navLoc;
-			controller->navSystem->GetRandomPointInNavigableRadius( agent->guardPost, wanderRange, navLoc );	// make sure it is on the navmesh
-			controller->targetLoc = navLoc.Location;
-			// start moving to new destination
-			controller->MoveToLocation( navLoc.Location );
+			// start moving to a new destination on the navmesh around the post. Head back to the post until its pool has been built
+			const TArray<FVector>& points = wanderPool->points;
+			FVector destination = points.Num() > 0 ? points[ context.random.RandRange( 0, points.Num() - 1 ) ] : snapshot.guardPost;
+			context.commands.MoveToTarget( snapshot.controller, destination );
 
 			// set up new wait timer
-			timeToWait = FMath::FRandRange( minWaitTime, maxWaitTime );
+			timeToWait = context.random.FRandRange( minWaitTime, maxWaitTime );
 		}
 	}
 
 	// swap to patrol state if waypoints are setup for agent
-	if ( agent->waypoints.Num() != 0 )
-		controller->SwapState( ( State* ) new PatrolState() );
-
-	// check if the agent has sensed the player
-	for ( auto& actor : controller->perceivedActors ) {
-		// if we have seen the player, try to fight
-		if ( actor == controller->GetAttackCircle()->GetPlayer() ) {
-			controller->SwapState( ( State* )new AlertState() );
-			break;
-		}
-		else
-			continue;
-	}
+	if ( snapshot.waypoints->Num() != 0 )
+		context.commands.SwapState( snapshot.controller, EAIStateType::AST_Patrol );
 }
 
 void GuardState::ExitState( AEnemyAgent* agent ) {
@@ -1,13 +1,14 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #pragma once
-#include "State.h"
+#include "AIStateContext.h"
 #include "EnemyAgent.h"
+#include "WanderPointPools.h"
 
 /**
  * 
  */
-class DRAGOON_API GuardState : State
+class DRAGOON_API GuardState
 {
 protected:
 	// distance that a guard can wander from their post
@@ -22,6 +23,9 @@ protected:
 	// maximum time to wait before moving again
 	float maxWaitTime = 8;
 
+	// points around the agent's post to wander between, shared with every guard at the post
+	const FWanderPointPool* wanderPool = nullptr;
+
 public:
 	GuardState();
 	~GuardState();
@@ -30,18 +34,17 @@ public:
 	* Initializes the wait timer to random value and move to location to be the agent's location.
 	* @param agent	The agent who is currently using this state for behavior.
 	*/
-	virtual void EnterState( AEnemyAgent* agent );
+	void EnterState( AEnemyAgent* agent );
 
 	/**
 	* Checks if agent has arrived at last randomly chosen location, and generates new location if it has.
-	* @param agent	The agent who is currently using this state for behavior.
-	* @param deltaSeconds	The amount of time that has passed since the last tick of the game engine
+	* @param context	The snapshot of the agent to read, and the commands to record into.
 	*/
-	virtual void StateTick( AEnemyAgent* agent, float deltaSeconds );
+	void StateTick( FAIStateContext& context );
 
 	/**
 	* 
 	* @param agent	The agent who is currently using this state for behavior.
 	*/
-	virtual void ExitState( AEnemyAgent* agent );
+	void ExitState( AEnemyAgent* agent );
 };
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "PatrolPathCache.h"
+#include "PatrolRoute.h"
+#include "AI/Navigation/NavigationSystem.h"
+
+PatrolPathCache::PatrolPathCache()
+{
+}
+
+PatrolPathCache::~PatrolPathCache()
+{
+	// remove every path
+	routePaths.Empty();
+}
+
+const TArray<FNavPathPoint>* PatrolPathCache::GetLegPoints( const UPatrolRoute* route, int32 leg, UNavigationSystem* navSystem ) {
+	int32 numWaypoints = route->waypoints.Num();
+	if ( !navSystem || leg < 0 || leg >= numWaypoints )
+		return nullptr;
+
+	TArray<FLegPath>& paths = routePaths.FindOrAdd( route );
+	if ( paths.Num() != numWaypoints )
+		paths.SetNum( numWaypoints );
+
+	// a leg with no path is remembered too, so it is not searched again every lap
+	FLegPath& path = paths[ leg ];
+	if ( !path.bIsFound ) {
+		ANavigationData* navData = navSystem->GetMainNavData( FNavigationSystem::DontCreate );
+		if ( !navData )
+			return nullptr;
+
+		FPathFindingQuery query( nullptr, *navData, route->waypoints[ leg ], route->waypoints[ ( leg + 1 ) % numWaypoints ] );
+		FPathFindingResult result = navSystem->FindPathSync( query );
+		path.points.Reset();
+		if ( result.IsSuccessful() && result.Path.IsValid() )
+			path.points = result.Path->GetPathPoints();
+		path.bIsFound = true;
+	}
+
+	return path.points.Num() > 0 ? &path.points : nullptr;
+}
+
+void PatrolPathCache::Invalidate() {
+	routePaths.Empty();
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "AI/Navigation/NavigationTypes.h"
+
+class UPatrolRoute;
+class UNavigationSystem;
+
+/**
+ * Keeps the points of the navigation path of every leg of every patrol route in use, so agents walking the same route follow
+ * paths found once instead of each pathfinding every leg of every lap. Legs are found the first time an agent walks them,
+ * and found again once the navmesh is regenerated. Only the points are shared: each agent follows a path object of its own
+ * built from them, since path following registers itself with the path it follows.
+ */
+class DRAGOON_API PatrolPathCache
+{
+private:
+	// points of one leg, and whether the leg has been searched since the navmesh was last regenerated
+	struct FLegPath {
+		TArray<FNavPathPoint> points;
+		bool bIsFound = false;
+	};
+
+	// path of each leg of a route. Leg i goes from waypoint i to the next waypoint
+	TMap<const UPatrolRoute*, TArray<FLegPath>> routePaths;
+
+public:
+	PatrolPathCache();
+	~PatrolPathCache();
+
+	/**
+	 * Returns the points of the path of a leg of a route, finding them if the leg has not been searched since the navmesh was last regenerated
+	 * @param route		the route the leg belongs to
+	 * @param leg		index of the waypoint the leg starts at
+	 * @param navSystem	the navigation system to find the path with
+	 * @returns	the points, or nullptr if there is no path
+	 */
+	const TArray<FNavPathPoint>* GetLegPoints( const UPatrolRoute* route, int32 leg, UNavigationSystem* navSystem );
+
+	/**
+	 * Forgets every path. Called when the navmesh has been regenerated
+	 */
+	void Invalidate();
+};
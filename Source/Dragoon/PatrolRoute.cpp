@@ -1,12 +1,4 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "Dragoon.h"
-#include "State.h"
-
-State::State()
-{
-}
-
-State::~State()
-{
-}
+#include "PatrolRoute.h"
@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Engine/DataAsset.h"
+#include "PatrolRoute.generated.h"
+
+/**
+ * A loop of waypoints that any number of agents can patrol. Agents on the same route share the paths between its waypoints,
+ * which are found once and kept by the game mode's patrol path cache.
+ */
+UCLASS( BlueprintType )
+class DRAGOON_API UPatrolRoute : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	// waypoints in world space, walked in order and back to the first
+	UPROPERTY( EditAnywhere, BlueprintReadOnly, Category = PatrolState )
+	TArray<FVector> waypoints;
+};
@@ -2,9 +2,7 @@
 
 #include "Dragoon.h"
 #include "DragoonAIController.h"
-#include "GuardState.h"
 #include "PatrolState.h"
-#include "AlertState.h"
 
 PatrolState::PatrolState()
 {
@@ -20,49 +18,44 @@ void PatrolState::EnterState( AEnemyAgent* agent ) {
 		timeToWait = FMath::FRandRange( minWaitTime, maxWaitTime );
 
 	// get the first waypoint for agent
-	UpdateWaypoint( agent );
+	ADragoonAIController* controller = ( ADragoonAIController* )agent->GetController();
+	const TArray<FVector>& waypoints = agent->GetPatrolWaypoints();
+	if ( waypoints.Num() > 0 )
+		controller->MoveToLocation( UpdateWaypoint( waypoints ) );
 
 	// set walk speed to look like normal marching
 	agent->GetCharacterMovement()->MaxWalkSpeed = 300;
 }
 
-void PatrolState::StateTick( AEnemyAgent* agent, float DeltaSeconds ) {
-	ADragoonAIController* controller = ( ADragoonAIController* )agent->GetController();
+void PatrolState::StateTick( FAIStateContext& context ) {
+	const FAIAgentSnapshot& snapshot = context.snapshot;
+	const TArray<FVector>& waypoints = *snapshot.waypoints;
 
 	// swap to guard state if no waypoints are setup for agent
-	if ( agent->waypoints.Num() == 0 )
-		controller->SwapState( ( State* )new GuardState() );
+	if ( waypoints.Num() == 0 ) {
+		context.commands.SwapState( snapshot.controller, EAIStateType::AST_Guard );
+		return;
+	}
 
 	// check if we are at the current waypoint
-	if ( FVector::PointsAreNear( agent->GetActorLocation(), agent->waypoints[ currentWaypoint ], 50 ) ) {
+	if ( FVector::PointsAreNear( snapshot.location, waypoints[ currentWaypoint ], 50 ) ) {
 		// agent waits and observes
-		if ( !agent->bIsPatrolContinuous ) {
+		if ( !snapshot.bIsPatrolContinuous ) {
 			// wait out timer
 			if ( timeToWait > 0 )
-				timeToWait -= DeltaSeconds;
+				timeToWait -= snapshot.deltaSeconds;
 			else {
 				// setup next waypoint location
-				UpdateWaypoint( agent );
+				MoveToNextWaypoint( context );
 				// set new wait timer
-				timeToWait = FMath::FRandRange( minWaitTime, maxWaitTime );
+				timeToWait = context.random.FRandRange( minWaitTime, maxWaitTime );
 			}
 		}
 		// agent doesn't wait at location
 		else {
 			// setup next waypoint location
-			UpdateWaypoint( agent );
-		}
-	}
-
-	// check if the agent has sensed the player
-	for ( auto& actor : controller->perceivedActors ) {
-		// if we have seen the player, try to fight
-		if ( actor == controller->GetAttackCircle()->GetPlayer() ) {
-			controller->SwapState( ( State* )new AlertState() );
-			break;
+			MoveToNextWaypoint( context );
 		}
-		else
-			continue;
 	}
 }
 
@@ -71,15 +64,25 @@ void PatrolState::ExitState( AEnemyAgent* agent ) {
 	agent->GetCharacterMovement()->MaxWalkSpeed = 600;
 }
 
-void PatrolState::UpdateWaypoint( AEnemyAgent* agent ) {
-	// grab handle for AI controller
-	ADragoonAIController* controller = ( ADragoonAIController* )agent->GetController();
-
+FVector PatrolState::UpdateWaypoint( const TArray<FVector>& waypoints ) {
 	// get next control point
 	currentWaypoint++;
 	// make sure we stay within the index bounds of the waypoint array
-	if ( currentWaypoint == agent->waypoints.Num() )
+	if ( currentWaypoint >= waypoints.Num() )
 		currentWaypoint = 0;
-	// set new destination
-	controller->MoveToLocation( agent->waypoints[ currentWaypoint ] );
+	// new destination
+	return waypoints[ currentWaypoint ];
+}
+
+void PatrolState::MoveToNextWaypoint( FAIStateContext& context ) {
+	const FAIAgentSnapshot& snapshot = context.snapshot;
+	// the leg starts at the waypoint the agent is leaving
+	int32 leg = currentWaypoint;
+	FVector destination = UpdateWaypoint( *snapshot.waypoints );
+
+	// agents on a shared route follow its cached paths, the rest find their own
+	if ( snapshot.patrolRoute )
+		context.commands.MoveAlongRoute( snapshot.controller, snapshot.patrolRoute, leg, destination );
+	else
+		context.commands.MoveToLocation( snapshot.controller, destination );
 }
@@ -1,13 +1,13 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #pragma once
-#include "State.h"
+#include "AIStateContext.h"
 #include "EnemyAgent.h"
 
 /**
  * 
  */
-class DRAGOON_API PatrolState : State
+class DRAGOON_API PatrolState
 {
 protected:
 	// keep current indexed waypoint
@@ -30,27 +30,33 @@ public:
 	* Sets initial wait timer if agent's patrol is set to wait at patrol points
 	* @param agent	The agent who is currently using this state for behavior.
 	*/
-	virtual void EnterState( AEnemyAgent* agent );
+	void EnterState( AEnemyAgent* agent );
 
 	/**
 	* Checks if agent has arrived at a patrol point. 
 	* Will update to the next patrol point either immediately or after a wait period depending on if the agent's patrol is continuous.
-	* @param agent	The agent who is currently using this state for behavior.
-	* @param deltaSeconds	The amount of time that has passed since the last tick of the game engine
+	* @param context	The snapshot of the agent to read, and the commands to record into.
 	*/
-	virtual void StateTick( AEnemyAgent* agent, float deltaSeconds );
+	void StateTick( FAIStateContext& context );
 
 	/**
 	* 
 	* @param agent	The agent who is currently using this state for behavior.
 	*/
-	virtual void ExitState( AEnemyAgent* agent );
+	void ExitState( AEnemyAgent* agent );
 
 protected:
 	/**
 	 * Gets the next waypoint from the agent's waypoint array.
 	 * Will get first point if index would exceed array bounds.
-	 * @param agent	The agent who is currently using this state for behavior.
+	 * @param waypoints	The waypoints of the agent who is currently using this state for behavior.
+	 * @returns	the waypoint to move to
+	 */
+	FVector UpdateWaypoint( const TArray<FVector>& waypoints );
+
+	/**
+	 * Advances to the next waypoint and records moving there, along the cached path of the leg if the agent patrols a shared route
+	 * @param context	The snapshot of the agent to read, and the commands to record into.
 	 */
-	void UpdateWaypoint( AEnemyAgent* agent );
+	void MoveToNextWaypoint( FAIStateContext& context );
 };
@@ -23,16 +23,27 @@ APlayerCharacter::~APlayerCharacter() {
 void APlayerCharacter::BeginPlay() {
 	Super::BeginPlay();
 
-	// setup attack circle with player
+	// setup an attack circle around the player
 	ADragoonGameMode* game = ( ADragoonGameMode* )GetWorld()->GetAuthGameMode();
-	attackCircle = &game->attackCircle;
-	attackCircle->SetPlayer( this );
-	attackCircle->Initialize();
+	attackCircle = game->attackCircles.AddPlayer( this );
 
 	// get reference to blackboard
 	AIBlackboard = &game->blackboard;
 }
 
+void APlayerCharacter::EndPlay( const EEndPlayReason::Type EndPlayReason ) {
+	// free up the prediction model if only this player is leaving. The whole blackboard goes away on level changes
+	if ( EndPlayReason == EEndPlayReason::Destroyed && AIBlackboard )
+		AIBlackboard->RemoveAttacker( this );
+
+	// free up the attack circle for another player
+	ADragoonGameMode* game = ( ADragoonGameMode* )GetWorld()->GetAuthGameMode();
+	if ( EndPlayReason == EEndPlayReason::Destroyed && game )
+		game->attackCircles.RemovePlayer( this );
+
+	Super::EndPlay( EndPlayReason );
+}
+
 void APlayerCharacter::MyTakeDamage( int dmg ) {
 	if ( GetIsDead() )
 		return;
@@ -68,7 +79,7 @@ void APlayerCharacter::PlayerAttack() {
 			for ( auto& target : hits ) {
 				if ( Cast<AEnemyAgent>( target.Actor.Get() ) ) {
 					// send attack information to blackboard because enemy was attacked and exit loop
-					AIBlackboard->RecordPlayerAttack( FAttack( ( EAttackDirection )directionOfAttack, type, ( AEnemyAgent* )target.Actor.Get() ) );
+					AIBlackboard->RecordPlayerAttack( FAttack( ( EAttackDirection )directionOfAttack, type, ( AEnemyAgent* )target.Actor.Get(), this ) );
 					break;
 				}
 			}
@@ -28,6 +28,9 @@ public:
 	// sets up the variables for class
 	virtual void BeginPlay() override;
 
+	// removes the player's attack prediction model when the player leaves the game
+	virtual void EndPlay( const EEndPlayReason::Type EndPlayReason ) override;
+
 	virtual void MyTakeDamage( int dmg ) override;
 
 protected:
@@ -0,0 +1,204 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "PlayerFlowFields.h"
+#include "AttackCircleManager.h"
+#include "AI/Navigation/NavigationSystem.h"
+
+DECLARE_CYCLE_STAT( TEXT( "Flow Fields" ), STAT_DragoonFlowFields, STATGROUP_DragoonAI );
+DECLARE_DWORD_COUNTER_STAT( TEXT( "Flow Field Rebuilds" ), STAT_DragoonFlowFieldRebuilds, STATGROUP_DragoonAI );
+
+bool FFlowField::GetSteeringTarget( const FVector& location, FVector& outTarget ) const {
+	if ( !player || nextCell.Num() == 0 )
+		return false;
+
+	FIntPoint cell( FMath::FloorToInt( location.X / cellSize ) - origin.X, FMath::FloorToInt( location.Y / cellSize ) - origin.Y );
+	if ( cell.X < 0 || cell.Y < 0 || cell.X >= cellsPerSide || cell.Y >= cellsPerSide )
+		return false;
+
+	int32 index = cell.Y * cellsPerSide + cell.X;
+	if ( nextCell[ index ] == INDEX_NONE || nextCell[ index ] == index )
+		return false;
+
+	// every cell points one cell closer to the player, and the player's cell points to itself. Stop before the field bends
+	// round something the agent can't walk straight through
+	int32 start = index;
+	for ( int32 step = 0; step < cellsPerSteer && nextCell[ index ] != index; step++ ) {
+		if ( !IsLineClear( start, nextCell[ index ] ) )
+			break;
+		index = nextCell[ index ];
+	}
+
+	outTarget = FVector( ( origin.X + index % cellsPerSide + 0.5f ) * cellSize, ( origin.Y + index / cellsPerSide + 0.5f ) * cellSize, cellHeights[ index ] );
+	return true;
+}
+
+bool FFlowField::IsLineClear( int32 from, int32 to ) const {
+	int32 x = from % cellsPerSide;
+	int32 y = from / cellsPerSide;
+	int32 dx = FMath::Abs( to % cellsPerSide - x );
+	int32 dy = FMath::Abs( to / cellsPerSide - y );
+	int32 stepX = to % cellsPerSide > x ? 1 : -1;
+	int32 stepY = to / cellsPerSide > y ? 1 : -1;
+
+	// walk every cell the line crosses, one cell boundary at a time
+	int32 numCrossings = dx + dy;
+	int32 error = dx - dy;
+	dx *= 2;
+	dy *= 2;
+	while ( numCrossings > 0 ) {
+		if ( error > 0 ) {
+			x += stepX;
+			error -= dy;
+			numCrossings--;
+		}
+		else if ( error < 0 ) {
+			y += stepY;
+			error += dx;
+			numCrossings--;
+		}
+		else {
+			// the line passes exactly through a corner, so neither cell beside it may be blocked
+			if ( !IsCellOpen( x + stepX, y ) || !IsCellOpen( x, y + stepY ) )
+				return false;
+			x += stepX;
+			y += stepY;
+			error += dx - dy;
+			numCrossings -= 2;
+		}
+
+		if ( !IsCellOpen( x, y ) )
+			return false;
+	}
+	return true;
+}
+
+PlayerFlowFields::PlayerFlowFields()
+{
+}
+
+PlayerFlowFields::~PlayerFlowFields()
+{
+	// remove every field and sample
+	fields.Empty();
+	cellSamples.Empty();
+}
+
+const FFlowField* PlayerFlowFields::GetField( int32 circleIndex ) const {
+	if ( !fields.IsValidIndex( circleIndex ) || !fields[ circleIndex ].player )
+		return nullptr;
+	return &fields[ circleIndex ];
+}
+
+void PlayerFlowFields::Tick( UNavigationSystem* navSystem ) {
+	SCOPE_CYCLE_COUNTER( STAT_DragoonFlowFields );
+	if ( !attackCircles )
+		return;
+
+	// states hold pointers to the fields while they decide, so fields are only added here, before they tick
+	if ( fields.Num() < attackCircles->GetNumCircles() )
+		fields.SetNum( attackCircles->GetNumCircles() );
+
+	int32 samplesLeft = maxSamplesPerFrame;
+	int32 numRebuilt = 0;
+	for ( int32 i = 0; i < attackCircles->GetNumCircles(); i++ ) {
+		FFlowField& field = fields[ i ];
+		AActor* player = attackCircles->GetCircle( i )->GetPlayer();
+		if ( !player ) {
+			field.player = nullptr;
+			continue;
+		}
+
+		// the field only changes when the player moves into another cell, or when cells have been sampled since it was built
+		FVector playerLocation = player->GetActorLocation();
+		FIntPoint playerCell = GetCell( playerLocation );
+		if ( player == field.player && playerCell == field.playerCell && !field.bIsDirty )
+			continue;
+
+		field.player = player;
+		field.playerCell = playerCell;
+		RebuildField( field, playerLocation, navSystem, samplesLeft );
+		numRebuilt++;
+	}
+
+	SET_DWORD_STAT( STAT_DragoonFlowFieldRebuilds, numRebuilt );
+}
+
+void PlayerFlowFields::Invalidate() {
+	cellSamples.Empty();
+	for ( FFlowField& field : fields )
+		field.bIsDirty = true;
+}
+
+FIntPoint PlayerFlowFields::GetCell( const FVector& location ) const {
+	float size = FMath::Max( cellSize, 1.0f );
+	return FIntPoint( FMath::FloorToInt( location.X / size ), FMath::FloorToInt( location.Y / size ) );
+}
+
+void PlayerFlowFields::RebuildField( FFlowField& field, const FVector& playerLocation, UNavigationSystem* navSystem, int32& samplesLeft ) {
+	int32 side = FMath::Max( cellsPerSide, 1 );
+	int32 numCells = side * side;
+	field.cellSize = FMath::Max( cellSize, 1.0f );
+	field.cellsPerSide = side;
+	field.cellsPerSteer = cellsPerSteer;
+	field.handoffDistance = handoffDistance;
+	field.origin = field.playerCell - FIntPoint( side / 2, side / 2 );
+	field.nextCell.Init( INDEX_NONE, numCells );
+	field.cellHeights.Init( playerLocation.Z, numCells );
+
+	// find which cells are on the navmesh. Cells crossed into since the last rebuild are the only ones not sampled already
+	TBitArray<> navigable( false, numCells );
+	bool bHasUnsampledCells = false;
+	FVector extent( field.cellSize * 0.5f, field.cellSize * 0.5f, maxCellHeightDifference );
+	for ( int32 index = 0; index < numCells; index++ ) {
+		FIntPoint worldCell = field.origin + FIntPoint( index % side, index / side );
+		FCellSample* sample = cellSamples.Find( worldCell );
+		if ( !sample && navSystem && samplesLeft > 0 ) {
+			FVector centre( ( worldCell.X + 0.5f ) * field.cellSize, ( worldCell.Y + 0.5f ) * field.cellSize, playerLocation.Z );
+			FNavLocation navLocation;
+			FCellSample newSample;
+			newSample.bIsNavigable = navSystem->ProjectPointToNavigation( centre, navLocation, extent );
+			newSample.height = newSample.bIsNavigable ? navLocation.Location.Z : playerLocation.Z;
+			sample = &cellSamples.Add( worldCell, newSample );
+			samplesLeft--;
+		}
+
+		// cells not sampled yet are kept out of the field until they are, and the field is built again once they have been.
+		// agents that can only reach the player through them find a path as usual meanwhile
+		if ( sample ) {
+			navigable[ index ] = sample->bIsNavigable;
+			field.cellHeights[ index ] = sample->height;
+		}
+		else
+			bHasUnsampledCells = true;
+	}
+	field.bIsDirty = bHasUnsampledCells;
+
+	// search out from the player. Each cell reached points back at the cell it was reached from, which is a step closer to the player.
+	// straight neighbours come first so agents walk straight where they can, and corners are only cut where both sides are open
+	static const FIntPoint neighbours[] = { FIntPoint( 1, 0 ), FIntPoint( -1, 0 ), FIntPoint( 0, 1 ), FIntPoint( 0, -1 ),
+		FIntPoint( 1, 1 ), FIntPoint( -1, 1 ), FIntPoint( 1, -1 ), FIntPoint( -1, -1 ) };
+	int32 playerIndex = ( side / 2 ) * side + side / 2;
+	TArray<int32> open;
+	open.Reserve( numCells );
+	open.Add( playerIndex );
+	field.nextCell[ playerIndex ] = playerIndex;
+	for ( int32 next = 0; next < open.Num(); next++ ) {
+		int32 index = open[ next ];
+		FIntPoint cell( index % side, index / side );
+		for ( const FIntPoint& offset : neighbours ) {
+			FIntPoint neighbour = cell + offset;
+			if ( neighbour.X < 0 || neighbour.Y < 0 || neighbour.X >= side || neighbour.Y >= side )
+				continue;
+
+			int32 neighbourIndex = neighbour.Y * side + neighbour.X;
+			if ( field.nextCell[ neighbourIndex ] != INDEX_NONE || !navigable[ neighbourIndex ] )
+				continue;
+			if ( offset.X != 0 && offset.Y != 0 && ( !navigable[ cell.Y * side + neighbour.X ] || !navigable[ neighbour.Y * side + cell.X ] ) )
+				continue;
+
+			field.nextCell[ neighbourIndex ] = index;
+			open.Add( neighbourIndex );
+		}
+	}
+}
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class AttackCircleManager;
+class UNavigationSystem;
+
+/**
+ * A square grid of cells centred on one player. Every cell a player can be walked to from knows the next cell on the
+ * way there, so an agent anywhere on the grid finds which way to go with a lookup instead of pathfinding.
+ * Only read by states while they decide, and only rebuilt on the game thread before they do.
+ */
+struct DRAGOON_API FFlowField {
+	// the player the field leads to. nullptr for circles without a player
+	AActor* player = nullptr;
+
+	// world cell of the player and of the grid's first cell
+	FIntPoint playerCell = FIntPoint::ZeroValue;
+	FIntPoint origin = FIntPoint::ZeroValue;
+
+	// size of a cell in cm and number of cells along each side of the grid
+	float cellSize = 100;
+	int32 cellsPerSide = 0;
+
+	// index of the next cell toward the player, the cell's own index for the player's cell, INDEX_NONE if the player can't be reached
+	TArray<int32> nextCell;
+
+	// height of the navmesh in each cell
+	TArray<float> cellHeights;
+
+	// cells followed each time an agent is steered, and distance in cm to its destination under which an agent stops steering and pathfinds
+	int32 cellsPerSteer = 6;
+	float handoffDistance = 800;
+
+	// true if the field has to be rebuilt even if the player has not changed cell
+	bool bIsDirty = true;
+
+	/**
+	 * Finds where an agent should walk to next on the way to the player. The target is always a cell the agent can walk to
+	 * in a straight line, so it can be moved there without finding a path
+	 * @param location	where the agent is
+	 * @param outTarget	the furthest cell up to cellsPerSteer cells further along the field that can be walked to in a straight line
+	 * @returns	false if the agent is off the grid, in the player's cell or somewhere the player can't be reached from
+	 */
+	bool GetSteeringTarget( const FVector& location, FVector& outTarget ) const;
+
+private:
+	/**
+	 * Returns true if every cell a straight line between the centres of two cells crosses can reach the player
+	 */
+	bool IsLineClear( int32 from, int32 to ) const;
+
+	/**
+	 * Returns true if a cell is on the grid and can reach the player
+	 */
+	FORCEINLINE bool IsCellOpen( int32 x, int32 y ) const { return x >= 0 && y >= 0 && x < cellsPerSide && y < cellsPerSide && nextCell[ y * cellsPerSide + x ] != INDEX_NONE; }
+};
+
+/**
+ * Keeps one flow field per player, so agents converging on a player steer along it instead of each finding its own path.
+ * A field is only rebuilt when its player moves into another cell or new cells have been sampled. Rebuilding searches the whole
+ * grid again rather than patching the cells whose way to the player changed: moving the player moves every cell's way, and a
+ * search of the grid is one pass over cellsPerSide squared cells at most once per cell the player crosses.
+ * Which cells are on the navmesh is sampled once per cell and shared by every field, a limited number of samples each frame,
+ * and sampled again when the navmesh is regenerated.
+ */
+class DRAGOON_API PlayerFlowFields
+{
+public:
+	// Size of a cell in cm
+	float cellSize = 100;
+
+	// Number of cells along each side of a field. Agents further than half of this from the player pathfind as usual
+	int32 cellsPerSide = 64;
+
+	// Most navmesh samples made in a single frame, across every field
+	int32 maxSamplesPerFrame = 256;
+
+	// Height in cm above and below the player searched for the navmesh in each cell
+	float maxCellHeightDifference = 200;
+
+	// Cells followed each time an agent is steered
+	int32 cellsPerSteer = 6;
+
+	// Distance in cm to its destination under which an agent stops steering and pathfinds the rest of the way
+	float handoffDistance = 800;
+
+private:
+	// What a navmesh sample found in one cell
+	struct FCellSample {
+		bool bIsNavigable;
+		float height;
+	};
+
+	// one field per circle, at the circle's index
+	TArray<FFlowField> fields;
+
+	// samples of every cell any field has covered, by world cell
+	TMap<FIntPoint, FCellSample> cellSamples;
+
+	// circles the players are read from
+	AttackCircleManager* attackCircles = nullptr;
+
+public:
+	PlayerFlowFields();
+	~PlayerFlowFields();
+
+	/**
+	 * Sets the attack circle manager the players are read from
+	 * @param circles	the manager of the attack circles, one per player
+	 */
+	FORCEINLINE void SetAttackCircles( AttackCircleManager* circles ) { attackCircles = circles; }
+
+	/**
+	 * Returns the field of a circle's player, or nullptr if the circle has no field yet
+	 * @param circleIndex	index of the circle
+	 */
+	const FFlowField* GetField( int32 circleIndex ) const;
+
+	/**
+	 * Rebuilds the fields of players who have moved into another cell
+	 * @param navSystem	the navigation system to sample
+	 */
+	void Tick( UNavigationSystem* navSystem );
+
+	/**
+	 * Forgets every sample and rebuilds every field. Called when the navmesh has been regenerated
+	 */
+	void Invalidate();
+
+private:
+	/**
+	 * Returns the world cell a location is in
+	 */
+	FIntPoint GetCell( const FVector& location ) const;
+
+	/**
+	 * Samples the cells of a field it has not got samples for, then finds the next cell toward the player from every cell
+	 * @param field			the field to rebuild
+	 * @param playerLocation	where the player is
+	 * @param navSystem		the navigation system to sample
+	 * @param samplesLeft	samples left this frame. Cells that can't be sampled are left out of the field until they are
+	 */
+	void RebuildField( FFlowField& field, const FVector& playerLocation, UNavigationSystem* navSystem, int32& samplesLeft );
+};
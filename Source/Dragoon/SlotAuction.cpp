@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "SlotAuction.h"
+
+void SlotAuction::Start( int32 bidderCount, int32 slotCount, const float* bidderCosts, float minIncrement ) {
+	check( bidderCount <= slotCount );
+	numBidders = bidderCount;
+	numSlots = slotCount;
+	epsilon = minIncrement;
+
+	costs.SetNumUninitialized( bidderCount * slotCount );
+	FMemory::Memcpy( costs.GetData(), bidderCosts, bidderCount * slotCount * sizeof( float ) );
+
+	// every slot starts free and every bidder starts without a slot
+	prices.Init( 0.0f, slotCount );
+	slotOwners.Init( -1, slotCount );
+	bidderSlots.Init( -1, bidderCount );
+	unassignedBidders.Reset();
+	for ( int32 bidder = bidderCount - 1; bidder >= 0; bidder-- )
+		unassignedBidders.Add( bidder );
+}
+
+bool SlotAuction::Run( int32 maxBids ) {
+	for ( int32 bid = 0; bid < maxBids && unassignedBidders.Num() > 0; bid++ ) {
+		int32 bidder = unassignedBidders.Pop( false );
+		const float* bidderCosts = &costs[ bidder * numSlots ];
+
+		// find the cheapest and second cheapest slots for the bidder, counting their prices
+		int32 bestSlot = 0;
+		float bestCost = MAX_FLT;
+		float secondCost = MAX_FLT;
+		for ( int32 slot = 0; slot < numSlots; slot++ ) {
+			float cost = bidderCosts[ slot ] + prices[ slot ];
+			if ( cost < bestCost ) {
+				secondCost = bestCost;
+				bestCost = cost;
+				bestSlot = slot;
+			}
+			else if ( cost < secondCost )
+				secondCost = cost;
+		}
+
+		// raise the price by as much as the bidder would still prefer the slot over their second choice
+		float increment = numSlots > 1 ? secondCost - bestCost : 0.0f;
+		prices[ bestSlot ] += increment + epsilon;
+
+		// take the slot, and put whoever held it back in the auction
+		int32 previousOwner = slotOwners[ bestSlot ];
+		if ( previousOwner >= 0 ) {
+			bidderSlots[ previousOwner ] = -1;
+			unassignedBidders.Add( previousOwner );
+		}
+		slotOwners[ bestSlot ] = bidder;
+		bidderSlots[ bidder ] = bestSlot;
+	}
+
+	return unassignedBidders.Num() == 0;
+}
+
+void SlotAuction::Cancel() {
+	numBidders = 0;
+	numSlots = 0;
+	unassignedBidders.Reset();
+}
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Assigns bidders to slots so the total cost of the assignment is as low as possible, using Bertsekas' auction algorithm.
+ * Unassigned bidders bid for the slot that is cheapest for them after its price, raising its price by how much better it is
+ * than their second choice. The auction can be run a few bids at a time so its cost can be spread over several frames.
+ * The result is within numBidders * epsilon of the lowest possible total cost.
+ */
+class DRAGOON_API SlotAuction
+{
+private:
+	// number of bidders and slots in the current auction. There are never more bidders than slots
+	int32 numBidders = 0;
+	int32 numSlots = 0;
+
+	// how much each bid raises a price above the bidder's second choice. Keeps the auction from stalling on ties
+	float epsilon = 1;
+
+	// cost of each bidder taking each slot, numBidders rows of numSlots
+	TArray<float> costs;
+
+	// price of each slot
+	TArray<float> prices;
+
+	// bidder holding each slot. -1 if no one has bid for it yet
+	TArray<int32> slotOwners;
+
+	// slot held by each bidder. -1 if the bidder has been outbid or has not bid yet
+	TArray<int32> bidderSlots;
+
+	// bidders without a slot
+	TArray<int32> unassignedBidders;
+
+public:
+	/**
+	 * Starts a new auction, discarding any auction in progress.
+	 * @param bidderCount	number of bidders. Must not be more than slotCount
+	 * @param slotCount		number of slots
+	 * @param bidderCosts	cost of each bidder taking each slot, bidderCount rows of slotCount. Copied
+	 * @param minIncrement	how much each bid raises a price above the bidder's second choice
+	 */
+	void Start( int32 bidderCount, int32 slotCount, const float* bidderCosts, float minIncrement );
+
+	/**
+	 * Runs the auction until every bidder has a slot or maxBids bids have been made.
+	 * @param maxBids	most bids to make before returning
+	 * @returns	true if every bidder has a slot
+	 */
+	bool Run( int32 maxBids );
+
+	/**
+	 * Ends the current auction without using its result
+	 */
+	void Cancel();
+
+	/** Returns true if an auction has been started and not finished or cancelled **/
+	FORCEINLINE bool IsRunning() const { return numBidders > 0; }
+	/** Returns true if every bidder of the current auction has a slot **/
+	FORCEINLINE bool IsFinished() const { return unassignedBidders.Num() == 0; }
+	/** Returns numBidders **/
+	FORCEINLINE int32 GetNumBidders() const { return numBidders; }
+	/** Returns the slot the bidder won, or -1 if the bidder has no slot yet **/
+	FORCEINLINE int32 GetBidderSlot( int32 bidder ) const { return bidderSlots[ bidder ]; }
+};
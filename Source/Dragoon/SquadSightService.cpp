@@ -0,0 +1,273 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "SquadSightService.h"
+#include "DragoonAIController.h"
+#include "AttackCircleManager.h"
+
+DECLARE_CYCLE_STAT( TEXT( "Sight" ), STAT_DragoonSight, STATGROUP_DragoonAI );
+DECLARE_DWORD_COUNTER_STAT( TEXT( "Sight Traces" ), STAT_DragoonSightTraces, STATGROUP_DragoonAI );
+DECLARE_DWORD_COUNTER_STAT( TEXT( "Shared Sightings" ), STAT_DragoonSharedSightings, STATGROUP_DragoonAI );
+
+SquadSightService::SquadSightService()
+{
+}
+
+SquadSightService::~SquadSightService()
+{
+}
+
+void SquadSightService::AddController( ADragoonAIController* controller ) {
+	if ( controller->GetSightIndex() >= 0 )
+		return;
+
+	FSightAgent sightAgent;
+	sightAgent.controller = controller;
+	sightAgent.cell = GetCell( controller->GetAgent()->GetActorLocation() );
+	sightAgent.seenPlayers = 0;
+	sightAgent.nextCheckTime = serviceTime;
+	sightAgent.bIsQueued = false;
+
+	int32 index = agents.Add( sightAgent );
+	controller->SetSightIndex( index );
+	cells.FindOrAdd( sightAgent.cell ).Add( index );
+}
+
+void SquadSightService::RemoveController( ADragoonAIController* controller ) {
+	int32 index = controller->GetSightIndex();
+	if ( index < 0 )
+		return;
+
+	RemoveFromCell( agents[ index ].cell, index );
+	if ( checkQueue.Num() > 0 && checkQueue[ 0 ] == index )
+		nextPlayerToCheck = 0;	// the agent being checked partway is gone
+	checkQueue.Remove( index );
+	seeingAgents.Remove( index );
+
+	// move the last agent into the freed index and fix every list that refers to it
+	int32 last = agents.Num() - 1;
+	if ( index != last ) {
+		TArray<int32>* cell = cells.Find( agents[ last ].cell );
+		int32 cellPosition = cell ? cell->Find( last ) : INDEX_NONE;
+		if ( cellPosition != INDEX_NONE )
+			( *cell )[ cellPosition ] = index;
+
+		int32 queuePosition = checkQueue.Find( last );
+		if ( queuePosition != INDEX_NONE )
+			checkQueue[ queuePosition ] = index;
+
+		int32 seeingPosition = seeingAgents.Find( last );
+		if ( seeingPosition != INDEX_NONE )
+			seeingAgents[ seeingPosition ] = index;
+
+		agents[ last ].controller->SetSightIndex( index );
+	}
+	agents.RemoveAtSwap( index, 1, false );
+	controller->SetSightIndex( -1 );
+}
+
+void SquadSightService::Tick( float deltaSeconds ) {
+	SCOPE_CYCLE_COUNTER( STAT_DragoonSight );
+	serviceTime += deltaSeconds;
+
+	// find the players. A circle's bit in seenPlayers stands for whichever player it has
+	Swap( players, lastPlayers );
+	players.Reset();
+	if ( attackCircles ) {
+		for ( int32 i = 0; i < attackCircles->GetNumCircles() && i < 32; i++ )
+			players.Add( attackCircles->GetCircle( i )->GetPlayer() );
+	}
+
+	// agents lose sight of players who have left. Going backwards keeps agents taken out of seeingAgents from being skipped
+	for ( int32 i = seeingAgents.Num() - 1; i >= 0; i-- ) {
+		int32 index = seeingAgents[ i ];
+		for ( int32 playerIndex = 0; playerIndex < lastPlayers.Num(); playerIndex++ ) {
+			bool bPlayerChanged = !players.IsValidIndex( playerIndex ) || players[ playerIndex ] != lastPlayers[ playerIndex ];
+			if ( bPlayerChanged && ( agents[ index ].seenPlayers & ( 1u << playerIndex ) ) )
+				SetPlayerSeen( index, playerIndex, lastPlayers[ playerIndex ], false );
+		}
+	}
+
+	// move a few agents to the cells they are in now
+	int32 numRehashed = FMath::Min( agentsRehashedPerFrame, agents.Num() );
+	for ( int32 i = 0; i < numRehashed; i++ ) {
+		if ( nextRehash >= agents.Num() )
+			nextRehash = 0;
+		RehashAgent( nextRehash++ );
+	}
+
+	// queue agents due a check in the cells around each player. Cells are as big as the lose sight radius, so no one further away can see them
+	for ( AActor* player : players ) {
+		if ( !player )
+			continue;
+
+		FIntPoint playerCell = GetCell( player->GetActorLocation() );
+		for ( int32 x = -1; x <= 1; x++ ) {
+			for ( int32 y = -1; y <= 1; y++ ) {
+				TArray<int32>* cell = cells.Find( playerCell + FIntPoint( x, y ) );
+				if ( !cell )
+					continue;
+
+				for ( int32 index : *cell ) {
+					FSightAgent& sightAgent = agents[ index ];
+					if ( !sightAgent.bIsQueued && serviceTime >= sightAgent.nextCheckTime ) {
+						sightAgent.bIsQueued = true;
+						checkQueue.Add( index );
+					}
+				}
+			}
+		}
+	}
+
+	// agents that see a player are checked even if they have left the player's cells, so they can lose sight of them
+	for ( int32 index : seeingAgents ) {
+		FSightAgent& sightAgent = agents[ index ];
+		if ( !sightAgent.bIsQueued && serviceTime >= sightAgent.nextCheckTime ) {
+			sightAgent.bIsQueued = true;
+			checkQueue.Add( index );
+		}
+	}
+
+	// check the agents that have waited longest until this frame's traces are spent. An agent the budget runs out partway
+	// through is finished next frame, starting from the player it stopped at
+	int32 numTraces = 0;
+	int32 numShared = 0;
+	int32 numChecked = 0;
+	bool bIsOutOfTraces = false;
+	while ( numChecked < checkQueue.Num() && !bIsOutOfTraces ) {
+		int32 index = checkQueue[ numChecked ];
+		ADragoonAIController* controller = agents[ index ].controller;
+		AEnemyAgent* agent = controller->GetAgent();
+		int32 playerIndex = agent && !agent->GetIsDead() ? nextPlayerToCheck : players.Num();
+
+		FVector eyeLocation = agent ? agent->GetPawnViewLocation() : FVector::ZeroVector;
+		FVector forward = agent ? agent->GetActorForwardVector() : FVector::ForwardVector;
+		float minDot = FMath::Cos( FMath::DegreesToRadians( peripheralVisionAngleDegrees ) );
+		for ( ; playerIndex < players.Num(); playerIndex++ ) {
+			AActor* player = players[ playerIndex ];
+			if ( !player )
+				continue;
+
+			// players already seen stay seen out to the lose sight radius
+			bool bWasSeen = ( agents[ index ].seenPlayers & ( 1u << playerIndex ) ) != 0;
+			FVector toPlayer = player->GetActorLocation() - eyeLocation;
+			float radius = bWasSeen ? loseSightRadius : sightRadius;
+			bool bIsSeen = toPlayer.SizeSquared() <= radius * radius && FVector::DotProduct( forward, toPlayer.GetSafeNormal() ) >= minDot;
+
+			bool bWasTraced = false;
+			if ( bIsSeen ) {
+				// take the result of a close agent that has just seen the player
+				if ( IsSightingShared( index, playerIndex, eyeLocation ) )
+					numShared++;
+				else if ( numTraces >= maxTracesPerFrame ) {
+					bIsOutOfTraces = true;
+					break;
+				}
+				else {
+					// the player is seen if nothing blocks the way to them
+					FHitResult hit;
+					FCollisionQueryParams params( FName( TEXT( "SquadSight" ) ), true, agent );
+					params.AddIgnoredActor( player );
+					bIsSeen = !agent->GetWorld()->LineTraceSingleByChannel( hit, eyeLocation, player->GetActorLocation(), ECC_Visibility, params );
+					numTraces++;
+					bWasTraced = true;
+				}
+			}
+
+			// only a trace of its own renews when the agent last saw the player, so a shared sighting is never shared on and
+			// agents close to each other can't keep each other seeing a player they have lost sight of
+			if ( bIsSeen && bWasTraced ) {
+				TArray<float, TInlineAllocator<4>>& lastSeenTimes = agents[ index ].lastSeenTimes;
+				while ( lastSeenTimes.Num() <= playerIndex )
+					lastSeenTimes.Add( -MAX_FLT );
+				lastSeenTimes[ playerIndex ] = serviceTime;
+			}
+			if ( bIsSeen != bWasSeen )
+				SetPlayerSeen( index, playerIndex, player, bIsSeen );
+		}
+
+		if ( bIsOutOfTraces ) {
+			nextPlayerToCheck = playerIndex;
+			break;
+		}
+
+		// the agent has been checked against every player
+		agents[ index ].bIsQueued = false;
+		agents[ index ].nextCheckTime = serviceTime + checkInterval;
+		nextPlayerToCheck = 0;
+		numChecked++;
+	}
+	checkQueue.RemoveAt( 0, numChecked, false );
+
+	SET_DWORD_STAT( STAT_DragoonSightTraces, numTraces );
+	SET_DWORD_STAT( STAT_DragoonSharedSightings, numShared );
+}
+
+FIntPoint SquadSightService::GetCell( const FVector& location ) const {
+	float cellSize = FMath::Max( loseSightRadius, 1.0f );
+	return FIntPoint( FMath::FloorToInt( location.X / cellSize ), FMath::FloorToInt( location.Y / cellSize ) );
+}
+
+void SquadSightService::RehashAgent( int32 index ) {
+	AEnemyAgent* agent = agents[ index ].controller->GetAgent();
+	if ( !agent )
+		return;
+
+	FIntPoint cell = GetCell( agent->GetActorLocation() );
+	if ( cell == agents[ index ].cell )
+		return;
+
+	RemoveFromCell( agents[ index ].cell, index );
+	agents[ index ].cell = cell;
+	cells.FindOrAdd( cell ).Add( index );
+}
+
+void SquadSightService::SetPlayerSeen( int32 index, int32 playerIndex, AActor* player, bool bSeen ) {
+	FSightAgent& sightAgent = agents[ index ];
+	uint32 bit = 1u << playerIndex;
+	if ( bSeen ) {
+		if ( !sightAgent.seenPlayers )
+			seeingAgents.Add( index );
+		sightAgent.seenPlayers |= bit;
+	}
+	else {
+		sightAgent.seenPlayers &= ~bit;
+		if ( !sightAgent.seenPlayers )
+			seeingAgents.RemoveSingleSwap( index );
+	}
+
+	sightAgent.controller->SetPlayerSensed( player, bSeen );
+}
+
+bool SquadSightService::IsSightingShared( int32 index, int32 playerIndex, const FVector& location ) const {
+	// sightings are shared across cell borders, so look in the cells around the agent's too
+	float shareRadiusSquared = shareRadius * shareRadius;
+	float earliestSeenTime = serviceTime - checkInterval;
+	const FIntPoint& agentCell = agents[ index ].cell;
+	for ( int32 x = -1; x <= 1; x++ ) {
+		for ( int32 y = -1; y <= 1; y++ ) {
+			const TArray<int32>* cell = cells.Find( agentCell + FIntPoint( x, y ) );
+			if ( !cell )
+				continue;
+
+			for ( int32 neighbour : *cell ) {
+				const FSightAgent& other = agents[ neighbour ];
+				if ( neighbour != index && ( other.seenPlayers & ( 1u << playerIndex ) ) && other.lastSeenTimes.IsValidIndex( playerIndex )
+					&& other.lastSeenTimes[ playerIndex ] >= earliestSeenTime
+					&& FVector::DistSquared( location, other.controller->GetAgent()->GetActorLocation() ) <= shareRadiusSquared )
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+void SquadSightService::RemoveFromCell( const FIntPoint& cell, int32 index ) {
+	TArray<int32>* indices = cells.Find( cell );
+	if ( !indices )
+		return;
+
+	indices->RemoveSingleSwap( index );
+	if ( indices->Num() == 0 )
+		cells.Remove( cell );
+}
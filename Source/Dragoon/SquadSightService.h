@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class ADragoonAIController;
+class AttackCircleManager;
+
+/**
+ * Decides which agents can see which players, for every agent at once, instead of each controller running its own sight sense.
+ * Agents are bucketed in a grid of cells as big as the lose sight radius, so only agents in the cells around a player are looked at.
+ * Line of sight traces are spread over frames, at most one per agent every checkInterval and at most maxTracesPerFrame in total.
+ * An agent close to another agent that has just seen a player takes that result instead of tracing.
+ * Controllers are told when they gain or lose sight of a player.
+ */
+class DRAGOON_API SquadSightService
+{
+public:
+	// Distance in cm an agent can first see a player from
+	float sightRadius = 1000;
+
+	// Distance in cm an agent that sees a player keeps seeing them to
+	float loseSightRadius = 1500;
+
+	// Angle in degrees either side of where the agent faces that it can see
+	float peripheralVisionAngleDegrees = 90;
+
+	// Seconds between checks of the same agent
+	float checkInterval = 0.2f;
+
+	// Most line of sight traces made in a single frame
+	int32 maxTracesPerFrame = 16;
+
+	// Distance in cm within which an agent takes the result of another agent that has just seen a player
+	float shareRadius = 400;
+
+	// Agents whose grid cell is updated each frame. Agents move slowly compared to the cell size, so they are rehashed a few at a time
+	int32 agentsRehashedPerFrame = 64;
+
+private:
+	// What the service knows about one agent
+	struct FSightAgent {
+		ADragoonAIController* controller;
+
+		// grid cell the agent was last put in
+		FIntPoint cell;
+
+		// bit i is set if the agent sees the player of circle i
+		uint32 seenPlayers;
+
+		// service time the agent may next be checked at
+		float nextCheckTime;
+
+		// service time a trace of the agent's own last found the player of each circle, by circle index. Sightings taken from other agents
+		// don't count. Circles past the end have not been seen
+		TArray<float, TInlineAllocator<4>> lastSeenTimes;
+
+		// true while the agent is waiting in checkQueue
+		bool bIsQueued;
+	};
+
+	// every agent, packed. Each controller stores its index
+	TArray<FSightAgent> agents;
+
+	// indices of the agents in each grid cell
+	TMap<FIntPoint, TArray<int32>> cells;
+
+	// indices of agents waiting for a check, oldest first
+	TArray<int32> checkQueue;
+
+	// player the first agent in checkQueue is checked against next. Above 0 when the trace budget ran out partway through the agent
+	int32 nextPlayerToCheck = 0;
+
+	// indices of agents that see at least one player
+	TArray<int32> seeingAgents;
+
+	// player of each circle this frame and last frame. nullptr for circles without a player
+	TArray<AActor*> players;
+	TArray<AActor*> lastPlayers;
+
+	// next agent to rehash
+	int32 nextRehash = 0;
+
+	// seconds the service has been ticked for
+	float serviceTime = 0;
+
+	// circles the players are read from
+	AttackCircleManager* attackCircles = nullptr;
+
+public:
+	SquadSightService();
+	~SquadSightService();
+
+	/**
+	 * Sets the attack circle manager the players are read from
+	 * @param circles	the manager of the attack circles, one per player
+	 */
+	FORCEINLINE void SetAttackCircles( AttackCircleManager* circles ) { attackCircles = circles; }
+
+	/**
+	 * Starts checking what a controller's agent can see
+	 * @param controller	the controller to tell about players it sees
+	 */
+	void AddController( ADragoonAIController* controller );
+
+	/**
+	 * Stops checking a controller's agent. Does nothing if the controller was not added
+	 * @param controller	the controller that is dying or leaving the game
+	 */
+	void RemoveController( ADragoonAIController* controller );
+
+	/**
+	 * Rehashes a few agents, queues agents near players for checks and makes this frame's traces
+	 * @param deltaSeconds	time since the last tick
+	 */
+	void Tick( float deltaSeconds );
+
+private:
+	/**
+	 * Returns the grid cell a location is in
+	 */
+	FIntPoint GetCell( const FVector& location ) const;
+
+	/**
+	 * Moves an agent to the cell it is in now
+	 */
+	void RehashAgent( int32 index );
+
+	/**
+	 * Tells an agent's controller it has gained or lost sight of the player of a circle
+	 */
+	void SetPlayerSeen( int32 index, int32 playerIndex, AActor* player, bool bSeen );
+
+	/**
+	 * Returns true if an agent within shareRadius of a location, in its cell or the cells around it, saw a player within the last checkInterval
+	 */
+	bool IsSightingShared( int32 index, int32 playerIndex, const FVector& location ) const;
+
+	/**
+	 * Removes an index from a cell's list
+	 */
+	void RemoveFromCell( const FIntPoint& cell, int32 index );
+};
@@ -3,27 +3,12 @@
 #pragma once
 #include "EnemyAgent.h"
 
-/**
- * Abstract class used to make other states for AI behavior
- */
-class DRAGOON_API State
-{
-public:
-	State();
-	~State();
-
-	/**
-	 * Logic to run when entering current state
-	 */
-	virtual void EnterState( AEnemyAgent* agent ) = 0;
-
-	/**
-	* Logic to update state every frame/specified time interval
-	*/
-	virtual void StateTick( AEnemyAgent* agent, float deltaSeconds ) = 0;
-
-	/**
-	* Logic to run when leaving current state
-	*/
-	virtual void ExitState( AEnemyAgent* agent ) = 0;
+// enum for the kinds of state an agent can be in. Agents are ticked in batches of the same kind, and the controller's
+// FAIStateMachine passes calls on to the state of this kind
+enum class EAIStateType : uint8 {
+	AST_Guard,
+	AST_Patrol,
+	AST_Alert,
+	AST_Attack,
+	AST_Count
 };
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Dragoon.h"
+#include "WanderPointPools.h"
+#include "AI/Navigation/NavigationSystem.h"
+
+WanderPointPools::WanderPointPools()
+{
+}
+
+WanderPointPools::~WanderPointPools()
+{
+	// remove every pool
+	buildQueue.Empty();
+	pools.Empty();
+}
+
+const FWanderPointPool* WanderPointPools::GetPool( const FVector& post, float radius ) {
+	// guards at the same post share its pool
+	for ( int32 i = 0; i < pools.Num(); i++ ) {
+		if ( FVector::PointsAreNear( pools[ i ].post, post, 1 ) && pools[ i ].radius == radius )
+			return &pools[ i ];
+	}
+
+	FWanderPointPool* pool = new FWanderPointPool();
+	pool->post = post;
+	pool->radius = radius;
+	pool->numSamplesTried = 0;
+	pool->bIsBuilding = false;
+	pools.Add( pool );
+	QueueBuild( pool );
+	return pool;
+}
+
+void WanderPointPools::RebuildAll() {
+	for ( int32 i = 0; i < pools.Num(); i++ )
+		QueueBuild( &pools[ i ] );
+}
+
+void WanderPointPools::Tick( UNavigationSystem* navSystem ) {
+	if ( !navSystem )
+		return;
+
+	int32 samplesLeft = maxSamplesPerFrame;
+	while ( samplesLeft > 0 && buildQueue.Num() > 0 ) {
+		FWanderPointPool* pool = buildQueue[ 0 ];
+		FNavLocation navLoc;
+		if ( navSystem->GetRandomPointInNavigableRadius( pool->post, pool->radius, navLoc ) )
+			pool->pendingPoints.Add( navLoc.Location );
+		pool->numSamplesTried++;
+		samplesLeft--;
+
+		// swap the new set in once it is full, or once so many samples have missed that the post is mostly off the navmesh
+		if ( pool->pendingPoints.Num() >= pointsPerPool || pool->numSamplesTried >= pointsPerPool * 4 ) {
+			if ( pool->pendingPoints.Num() > 0 )
+				Swap( pool->points, pool->pendingPoints );
+			pool->pendingPoints.Reset();
+			pool->bIsBuilding = false;
+			buildQueue.RemoveAt( 0 );
+		}
+	}
+}
+
+void WanderPointPools::QueueBuild( FWanderPointPool* pool ) {
+	// start the set again from scratch
+	pool->pendingPoints.Reset();
+	pool->numSamplesTried = 0;
+	if ( !pool->bIsBuilding ) {
+		pool->bIsBuilding = true;
+		buildQueue.Add( pool );
+	}
+}
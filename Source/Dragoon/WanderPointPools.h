@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class UNavigationSystem;
+
+/**
+ * Points on the navmesh around one guard post that guards there wander between
+ */
+struct FWanderPointPool {
+	// the post and how far from it points may be
+	FVector post;
+	float radius;
+
+	// points guards draw from. Left as they are while a new set is built, so guards always have somewhere to go
+	TArray<FVector> points;
+
+	// points found so far for the set being built
+	TArray<FVector> pendingPoints;
+
+	// samples tried for the set being built. Building gives up once too many samples have missed the navmesh
+	int32 numSamplesTried;
+
+	// true while the pool is waiting in the build queue
+	bool bIsBuilding;
+};
+
+/**
+ * Owns one pool of wander points per guard post, shared by every guard at that post. Pools are filled a few navmesh samples
+ * each frame rather than when a guard needs somewhere to go, and are built again when the navmesh is regenerated.
+ * Guards draw from a pool in constant time without any navmesh query.
+ */
+class DRAGOON_API WanderPointPools
+{
+public:
+	// Number of points in each pool
+	int32 pointsPerPool = 16;
+
+	// Most navmesh samples made in a single frame, across every pool
+	int32 maxSamplesPerFrame = 16;
+
+private:
+	// one pool per post. Pools are never removed, so guards can hold on to them
+	TIndirectArray<FWanderPointPool> pools;
+
+	// pools waiting to be built, in the order they were asked for
+	TArray<FWanderPointPool*> buildQueue;
+
+public:
+	WanderPointPools();
+	~WanderPointPools();
+
+	// guards hold pointers to the pools, so the pools cannot be copied
+	WanderPointPools( const WanderPointPools& ) = delete;
+	WanderPointPools& operator=( const WanderPointPools& ) = delete;
+
+	/**
+	 * Returns the pool for a post, creating it and queueing it to be built if no guard has asked for it before
+	 * @param post		the guard post
+	 * @param radius	how far from the post guards may wander
+	 */
+	const FWanderPointPool* GetPool( const FVector& post, float radius );
+
+	/**
+	 * Queues every pool to be built again. Called when the navmesh has been regenerated
+	 */
+	void RebuildAll();
+
+	/**
+	 * Spends this frame's samples building queued pools
+	 * @param navSystem	the navigation system to sample
+	 */
+	void Tick( UNavigationSystem* navSystem );
+
+private:
+	/**
+	 * Queues a pool to be built if it is not already waiting
+	 */
+	void QueueBuild( FWanderPointPool* pool );
+};
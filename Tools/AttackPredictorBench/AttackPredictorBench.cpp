@@ -0,0 +1,408 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// Headless benchmark and accuracy harness for the attack prediction code used by DragoonAIBlackboard.
+// Replays a sequence of attack IDs through an attack model exactly like RecordPlayerAttack does,
+// then reports how fast updates and predictions are and how good the predictions and their confidence are.
+//
+// Usage: AttackPredictorBench [options]
+//   --synthetic <count>	replay a generated player session of count attacks (default 200000)
+//   --ids <file>			replay attack IDs (0-26) read from a whitespace separated text file
+//   --trace <file>			replay an attack trace recorded by the game, also comparing against the predictions recorded in it
+//   --write-trace <file>	write the replayed attacks as an attack trace, e.g. to turn a synthetic session into a trace
+//   --prior <file>			use a learned attack model file as the prior
+//   --seed <n>				seed for the synthetic session and the prediction draws (default 1)
+//   --order <n>			longest context order of the N-gram (default 4)
+//   --history <n>			recent history window of the N-gram (default 50)
+//   --weight <f>			recent history weight of the N-gram (default 2)
+//   --repeat <n>			times to repeat each timing pass, keeping the fastest (default 3)
+
+#include "AttackModelFile.h"
+#include "AttackModelPool.h"
+#include "AttackTrace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <vector>
+
+// settings for one benchmark run
+struct FBenchSettings {
+	int32 syntheticCount = 200000;
+	const char* idsPath = nullptr;
+	const char* tracePath = nullptr;
+	const char* writeTracePath = nullptr;
+	const char* priorPath = nullptr;
+	uint32 seed = 1;
+	int32 order = 4;
+	int32 historySize = 50;
+	float historyWeight = 2;
+	int32 repeat = 3;
+};
+
+// number of bins used to measure how well predictionConfidence matches the real hit rate
+static const int32 NumCalibrationBins = 10;
+
+// prediction quality gathered over a replay
+struct FAccuracyResults {
+	int64 numAttacks = 0;
+	int64 top1Hits = 0;				// most probable attack was the one made
+	int64 predictionHits = 0;		// nextAttackPrediction, the drawn prediction the game reacts to, was the one made
+	double logLoss = 0;				// sum of -log2 of the probability given to the attack made
+	double brierScore = 0;			// sum of ( confidence - hit )^2
+	int64 binCounts[ NumCalibrationBins ] = {};
+	double binConfidence[ NumCalibrationBins ] = {};
+	int64 binHits[ NumCalibrationBins ] = {};
+};
+
+// uniform random values for the prediction draws, standing in for FMath::FRand
+class FRandomValues {
+	std::mt19937 engine;
+	std::uniform_real_distribution<float> distribution;
+public:
+	explicit FRandomValues( uint32 seed ) : engine( seed ), distribution( 0.0f, 1.0f ) {}
+	float Next() {
+		float value = distribution( engine );
+		return value < 1.0f ? value : 0.0f;
+	}
+};
+
+static double SecondsSince( std::chrono::steady_clock::time_point start ) {
+	return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+static void PrintUsage() {
+	printf( "Usage: AttackPredictorBench [--synthetic <count> | --ids <file> | --trace <file>] [--write-trace <file>] [--prior <file>] [--seed <n>]\n"
+		"                            [--order <n>] [--history <n>] [--weight <f>] [--repeat <n>]\n" );
+}
+
+static bool ParseArguments( int argc, char** argv, FBenchSettings& settings ) {
+	for ( int i = 1; i < argc; i++ ) {
+		const char* argument = argv[ i ];
+		const char* value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+		if ( !value ) {
+			PrintUsage();
+			return false;
+		}
+
+		if ( strcmp( argument, "--synthetic" ) == 0 )
+			settings.syntheticCount = atoi( value );
+		else if ( strcmp( argument, "--ids" ) == 0 )
+			settings.idsPath = value;
+		else if ( strcmp( argument, "--trace" ) == 0 )
+			settings.tracePath = value;
+		else if ( strcmp( argument, "--write-trace" ) == 0 )
+			settings.writeTracePath = value;
+		else if ( strcmp( argument, "--prior" ) == 0 )
+			settings.priorPath = value;
+		else if ( strcmp( argument, "--seed" ) == 0 )
+			settings.seed = ( uint32 )strtoul( value, nullptr, 10 );
+		else if ( strcmp( argument, "--order" ) == 0 )
+			settings.order = atoi( value );
+		else if ( strcmp( argument, "--history" ) == 0 )
+			settings.historySize = atoi( value );
+		else if ( strcmp( argument, "--weight" ) == 0 )
+			settings.historyWeight = ( float )atof( value );
+		else if ( strcmp( argument, "--repeat" ) == 0 )
+			settings.repeat = std::max( 1, atoi( value ) );
+		else {
+			PrintUsage();
+			return false;
+		}
+		i++;
+	}
+	return true;
+}
+
+/**
+ * Generates a player session made of a few favourite combos with some random attacks mixed in.
+ * Which combos are favoured changes every so often so the recent history weighting gets exercised.
+ */
+static std::vector<int32> GenerateSyntheticSession( int32 count, uint32 seed ) {
+	std::mt19937 engine( seed );
+	std::uniform_int_distribution<int32> randomAttack( 0, AttackNGram::NumAttacks - 1 );
+	std::uniform_int_distribution<int32> comboLength( 2, 5 );
+	std::uniform_real_distribution<float> chance( 0.0f, 1.0f );
+
+	// a set of combos the player knows
+	const int32 numCombos = 8;
+	std::vector<std::vector<int32>> combos( numCombos );
+	for ( std::vector<int32>& combo : combos ) {
+		combo.resize( comboLength( engine ) );
+		for ( int32& attack : combo )
+			attack = randomAttack( engine );
+	}
+
+	const int32 styleLength = 2000;	// attacks before the player's favourite combos change
+	const float noise = 0.1f;		// chance of a random attack instead of the next attack of a combo
+
+	// each combo is half as likely as the one before it
+	std::vector<float> comboWeights( numCombos );
+	for ( int32 i = 0; i < numCombos; i++ )
+		comboWeights[ i ] = 1.0f / ( float )( 1 << i );
+	std::discrete_distribution<int32> pickCombo( comboWeights.begin(), comboWeights.end() );
+
+	std::vector<int32> session;
+	session.reserve( count );
+	int32 nextStyleChange = 0;
+	while ( ( int32 )session.size() < count ) {
+		// pick new favourites
+		if ( ( int32 )session.size() >= nextStyleChange ) {
+			std::shuffle( combos.begin(), combos.end(), engine );
+			nextStyleChange += styleLength;
+		}
+
+		for ( int32 attack : combos[ pickCombo( engine ) ] ) {
+			if ( ( int32 )session.size() == count )
+				break;
+			session.push_back( chance( engine ) < noise ? randomAttack( engine ) : attack );
+		}
+	}
+	return session;
+}
+
+static bool LoadAttackIDs( const char* path, std::vector<int32>& outSession ) {
+	std::ifstream file( path );
+	if ( !file ) {
+		fprintf( stderr, "Could not open %s\n", path );
+		return false;
+	}
+
+	int32 attack;
+	while ( file >> attack ) {
+		if ( attack < 0 || attack >= AttackNGram::NumAttacks ) {
+			fprintf( stderr, "Invalid attack ID %d in %s\n", attack, path );
+			return false;
+		}
+		outSession.push_back( attack );
+	}
+	return true;
+}
+
+/**
+ * Replays a session through a model the same way DragoonAIBlackboard::RecordPlayerAttack does, measuring prediction quality.
+ */
+static FAccuracyResults MeasureAccuracy( const std::vector<int32>& session, const FBenchSettings& settings, const AttackModelFile& prior ) {
+	AttackModelPool pool( settings.order, settings.historySize, settings.historyWeight );
+	pool.SetPrior( prior.GetContexts(), prior.GetTableSize() );
+	FAttackModel& model = pool.GetModel( &pool );
+	FRandomValues random( settings.seed );
+
+	FAccuracyResults results;
+	float probabilities[ AttackNGram::NumAttacks ];
+	for ( int32 attack : session ) {
+		// score the prediction made before this attack
+		model.nGram.GetPrediction( probabilities );
+		int32 mostProbable = ( int32 )( std::max_element( probabilities, probabilities + AttackNGram::NumAttacks ) - probabilities );
+		bool bHit = model.nextAttackPrediction == attack;
+		float confidence = model.predictionConfidence;
+
+		results.numAttacks++;
+		results.top1Hits += mostProbable == attack ? 1 : 0;
+		results.predictionHits += bHit ? 1 : 0;
+		results.logLoss -= std::log2( std::max( probabilities[ attack ], 1e-12f ) );
+		results.brierScore += ( confidence - ( bHit ? 1.0 : 0.0 ) ) * ( confidence - ( bHit ? 1.0 : 0.0 ) );
+		int32 bin = std::min( ( int32 )( confidence * NumCalibrationBins ), NumCalibrationBins - 1 );
+		results.binCounts[ bin ]++;
+		results.binConfidence[ bin ] += confidence;
+		results.binHits[ bin ] += bHit ? 1 : 0;
+
+		// same steps as RecordPlayerAttack
+		model.UpdateConfidence( attack );
+		model.nGram.RecordAttack( attack );
+		model.PredictNextAttack( random.Next() );
+	}
+	return results;
+}
+
+/**
+ * Returns the fastest time in seconds to replay the session, either only updating the model or also predicting after every attack.
+ */
+static double TimeReplay( const std::vector<int32>& session, const FBenchSettings& settings, const AttackModelFile& prior, bool bPredict ) {
+	// draw the random values up front so they are not part of the timing
+	std::vector<float> randomValues( session.size() );
+	FRandomValues random( settings.seed );
+	for ( float& value : randomValues )
+		value = random.Next();
+
+	double fastest = 1e30;
+	for ( int32 pass = 0; pass < settings.repeat; pass++ ) {
+		AttackModelPool pool( settings.order, settings.historySize, settings.historyWeight );
+		pool.SetPrior( prior.GetContexts(), prior.GetTableSize() );
+		FAttackModel& model = pool.GetModel( &pool );
+
+		auto start = std::chrono::steady_clock::now();
+		for ( size_t i = 0; i < session.size(); i++ ) {
+			model.UpdateConfidence( session[ i ] );
+			model.nGram.RecordAttack( session[ i ] );
+			if ( bPredict )
+				model.PredictNextAttack( randomValues[ i ] );
+		}
+		fastest = std::min( fastest, SecondsSince( start ) );
+
+		// keep the optimizer from dropping the replay
+		if ( model.nextAttackPrediction < 0 )
+			printf( "unreachable\n" );
+	}
+	return fastest;
+}
+
+/**
+ * Returns the fastest time in seconds for many predictions from the same model state, like many agents predicting in one frame.
+ */
+static double TimeRepeatedPredictions( const std::vector<int32>& session, const FBenchSettings& settings, const AttackModelFile& prior, int32 numPredictions ) {
+	AttackModelPool pool( settings.order, settings.historySize, settings.historyWeight );
+	pool.SetPrior( prior.GetContexts(), prior.GetTableSize() );
+	FAttackModel& model = pool.GetModel( &pool );
+	for ( int32 attack : session )
+		model.nGram.RecordAttack( attack );
+
+	FRandomValues random( settings.seed );
+	std::vector<float> randomValues( numPredictions );
+	for ( float& value : randomValues )
+		value = random.Next();
+
+	double fastest = 1e30;
+	int64 checksum = 0;
+	for ( int32 pass = 0; pass < settings.repeat; pass++ ) {
+		auto start = std::chrono::steady_clock::now();
+		for ( float value : randomValues )
+			checksum += model.nGram.PredictAttack( value );
+		fastest = std::min( fastest, SecondsSince( start ) );
+	}
+
+	// keep the optimizer from dropping the predictions
+	if ( checksum < 0 )
+		printf( "unreachable\n" );
+	return fastest;
+}
+
+static void PrintResults( const std::vector<int32>& session, const FBenchSettings& settings, const AttackModelFile& prior ) {
+	const double count = ( double )session.size();
+	FAccuracyResults accuracy = MeasureAccuracy( session, settings, prior );
+	double updateSeconds = TimeReplay( session, settings, prior, false );
+	double replaySeconds = TimeReplay( session, settings, prior, true );
+	double predictSeconds = std::max( replaySeconds - updateSeconds, 1e-9 );
+	const int32 numRepeated = 1000000;
+	double repeatedSeconds = TimeRepeatedPredictions( session, settings, prior, numRepeated );
+
+	printf( "attacks replayed          %lld\n", ( long long )session.size() );
+	printf( "order / history / weight  %d / %d / %g\n", settings.order, settings.historySize, settings.historyWeight );
+	printf( "prior contexts            %d\n", prior.GetNumContexts() );
+	printf( "\n" );
+	printf( "ns per update             %.1f\n", updateSeconds * 1e9 / count );
+	printf( "predictions/sec (replay)  %.0f\n", count / predictSeconds );
+	printf( "predictions/sec (cached)  %.0f\n", numRepeated / repeatedSeconds );
+	printf( "\n" );
+	printf( "top-1 accuracy            %.2f%%\n", 100.0 * accuracy.top1Hits / count );
+	printf( "drawn prediction accuracy %.2f%%\n", 100.0 * accuracy.predictionHits / count );
+	printf( "log loss (bits/attack)    %.3f\n", accuracy.logLoss / count );
+	printf( "\n" );
+	printf( "predictionConfidence calibration\n" );
+	printf( "  confidence      attacks   mean conf   hit rate\n" );
+	double calibrationError = 0;
+	for ( int32 bin = 0; bin < NumCalibrationBins; bin++ ) {
+		if ( accuracy.binCounts[ bin ] == 0 )
+			continue;
+		double meanConfidence = accuracy.binConfidence[ bin ] / accuracy.binCounts[ bin ];
+		double hitRate = ( double )accuracy.binHits[ bin ] / accuracy.binCounts[ bin ];
+		calibrationError += std::fabs( meanConfidence - hitRate ) * accuracy.binCounts[ bin ] / count;
+		printf( "  %.1f - %.1f  %12lld   %9.3f   %8.3f\n", ( float )bin / NumCalibrationBins, ( float )( bin + 1 ) / NumCalibrationBins,
+			( long long )accuracy.binCounts[ bin ], meanConfidence, hitRate );
+	}
+	printf( "expected calibration error %.3f\n", calibrationError );
+	printf( "brier score               %.3f\n", accuracy.brierScore / count );
+}
+
+/**
+ * Writes a session to an attack trace through AttackTraceWriter, one attack per second from a single attacker
+ */
+static bool WriteTrace( const char* path, const std::vector<int32>& session ) {
+	AttackTraceWriter writer;
+	if ( !writer.Open( path ) ) {
+		fprintf( stderr, "Could not create attack trace %s\n", path );
+		return false;
+	}
+
+	for ( size_t i = 0; i < session.size(); i++ ) {
+		FAttackTraceRecord record = {};
+		record.timeSeconds = ( double )i;
+		record.attackID = ( uint8 )session[ i ];
+		record.direction = ( uint8 )( session[ i ] % 9 );
+		record.type = ( uint8 )( session[ i ] - session[ i ] % 9 );
+
+		// the queue only drops records when it is full, so wait for the writer rather than lose attacks
+		while ( !writer.Append( record ) && !writer.HasWriteFailed() )
+			std::this_thread::yield();
+	}
+	writer.Close();
+	if ( writer.HasWriteFailed() ) {
+		fprintf( stderr, "Could not write attack trace %s\n", path );
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Replays a recorded trace through a model per attacker and compares the replayed predictions with the ones recorded in the trace
+ */
+static void PrintTraceReplay( const std::vector<FAttackTraceRecord>& records, const FBenchSettings& settings, const AttackModelFile& prior ) {
+	AttackModelPool pool( settings.order, settings.historySize, settings.historyWeight );
+	pool.SetPrior( prior.GetContexts(), prior.GetTableSize() );
+	FAttackReplayResults results = AttackTraceReplayer::Replay( records, pool, settings.seed );
+
+	const double count = ( double )std::max<int64>( results.numAttacks, 1 );
+	printf( "trace replay\n" );
+	printf( "  seconds of play          %.1f\n", results.traceSeconds );
+	printf( "  replay speedup           %.0fx\n", results.traceSeconds / std::max( results.replaySeconds, 1e-9 ) );
+	printf( "  recorded prediction hits %.2f%%\n", 100.0 * results.recordedHits / count );
+	printf( "  replayed prediction hits %.2f%%\n", 100.0 * results.replayedHits / count );
+	printf( "  replayed mean confidence %.3f\n", results.replayedConfidence / count );
+	printf( "\n" );
+}
+
+int main( int argc, char** argv ) {
+	FBenchSettings settings;
+	if ( !ParseArguments( argc, argv, settings ) )
+		return 1;
+
+	// load or generate the attacks to replay
+	std::vector<int32> session;
+	std::vector<FAttackTraceRecord> trace;
+	if ( settings.tracePath ) {
+		if ( !AttackTraceReplayer::Load( settings.tracePath, trace ) ) {
+			fprintf( stderr, "Could not load attack trace %s\n", settings.tracePath );
+			return 1;
+		}
+		for ( const FAttackTraceRecord& record : trace )
+			session.push_back( record.attackID );
+	}
+	else if ( settings.idsPath ) {
+		if ( !LoadAttackIDs( settings.idsPath, session ) )
+			return 1;
+	}
+	else
+		session = GenerateSyntheticSession( settings.syntheticCount, settings.seed );
+
+	if ( session.empty() ) {
+		fprintf( stderr, "No attacks to replay\n" );
+		return 1;
+	}
+
+	AttackModelFile prior;
+	if ( settings.priorPath && !prior.Open( settings.priorPath ) ) {
+		fprintf( stderr, "Could not load attack model %s\n", settings.priorPath );
+		return 1;
+	}
+
+	if ( settings.writeTracePath && !WriteTrace( settings.writeTracePath, session ) )
+		return 1;
+
+	if ( !trace.empty() )
+		PrintTraceReplay( trace, settings, prior );
+	PrintResults( session, settings, prior );
+	return 0;
+}
@@ -0,0 +1,6 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// Stand-in for the engine header of the same name when the prediction code is built without Unreal.
+// windows.h can be included directly outside the engine, so there is nothing to hide.
+
+#pragma once
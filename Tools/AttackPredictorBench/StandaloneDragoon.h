@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// Stand-in for Dragoon.h when the prediction code is built without Unreal.
+// Only provides the engine types and macros the prediction sources use.
+
+#pragma once
+#include <cstdint>
+
+typedef int8_t int8;
+typedef int16_t int16;
+typedef int32_t int32;
+typedef int64_t int64;
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef uint64_t uint64;
+typedef uintptr_t UPTRINT;
+
+#define DRAGOON_API
+#define FORCEINLINE inline
+
+#ifdef _WIN32
+#define PLATFORM_WINDOWS 1
+#else
+#define PLATFORM_WINDOWS 0
+#endif